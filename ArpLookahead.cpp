@@ -0,0 +1,311 @@
+/***** ArpLookahead.cpp *****/
+
+#include "ArpLookahead.h"
+
+#include <stdexcept>
+
+
+float (ProbabilisticArp::*const ArpLookahead::kTempGetters[kNumTemps])() = {
+	&ProbabilisticArp::getIntervalTemp, &ProbabilisticArp::getContourTemp, &ProbabilisticArp::getRhythmicTemp,
+	&ProbabilisticArp::getSparsity, &ProbabilisticArp::getConsistency, &ProbabilisticArp::getMovement,
+	&ProbabilisticArp::getHarmonicTemp, &ProbabilisticArp::getDynamicTemp, &ProbabilisticArp::getDynamicContourTemp,
+	&ProbabilisticArp::getPitchTemp
+};
+
+void (ProbabilisticArp::*const ArpLookahead::kTempSetters[kNumTemps])(float) = {
+	&ProbabilisticArp::setIntervalTemp, &ProbabilisticArp::setContourTemp, &ProbabilisticArp::setRhythmicTemp,
+	&ProbabilisticArp::setSparsity, &ProbabilisticArp::setConsistency, &ProbabilisticArp::setMovement,
+	&ProbabilisticArp::setHarmonicTemp, &ProbabilisticArp::setDynamicTemp, &ProbabilisticArp::setDynamicContourTemp,
+	&ProbabilisticArp::setPitchTemp
+};
+
+
+ArpLookahead::ArpLookahead(ProbabilisticArp& arp, unsigned int steps)
+	: arp_(arp), length_(arp.getSequenceLength()), generated_(0), epoch_(0), claim_(Claim {0, 0, 0, 0}),
+	  seed1_(arp.getSeeds()[0]), seed2_(arp.getSeeds()[1]), seedBalance_(arp.getSeedBalance()),
+	  tempDist_(arp.getTempDistChoice()), key_(arp.getKey()), mode_(arp.getMode()), playing_(arp.isPlaying()),
+	  resetPending_(false), resetSeed1_(0), resetSeed2_(0), resetSeedBalance_(0), changes_(0), 
+	  applied_(0), appliedSeed1_(seed1_), appliedSeed2_(seed2_), position_(arp.getSequencePosition())
+{
+	if (steps == 0 || steps > kMaxSteps) {
+		throw std::invalid_argument("Invalid argument to 'ArpLookahead': steps");
+	}
+	steps_ = steps;
+
+	for (unsigned int n = 0; n < kNumTemps; n++) {
+		temps_[n].store((arp_.*kTempGetters[n])(), std::memory_order_relaxed);
+	}
+}
+
+ArpLookahead::Step ArpLookahead::next()
+{
+	Step step;
+	bool current = changes_.load(std::memory_order_acquire) == applied_.load(std::memory_order_acquire);
+	if (!current || !claimQueued(step)) {
+		// nothing ready, or new settings: generate the step here, unless the worker has the arpeggiator
+		if (!busy_.test_and_set(std::memory_order_acquire)) {
+			// the worker may have applied the settings and queued steps since they were checked
+			catchUp();
+			if (!claimQueued(step)) {
+				step = generateStep();
+				claim(step);
+			}
+			busy_.clear(std::memory_order_release);
+		}
+		else if (!claimQueued(step)) {
+			// a step from before the latest settings would have done, but there is none
+			step = claimRest();
+		}
+	}
+
+	position_ = step.position;
+	return step;
+}
+
+bool ArpLookahead::claim(const Step& step)
+{
+	// the holder of the flag may move the epoch on at any moment, so retry until the word is unchanged
+	Claim current = claim_.load(std::memory_order_acquire);
+	while (current.played == step.index && current.epoch == step.epoch) {
+		Claim next = current;
+		next.played++;
+		if (claim_.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ArpLookahead::claimQueued(Step& step)
+{
+	while (queue_.pop(step)) {
+		if (claim(step)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+ArpLookahead::Step ArpLookahead::claimRest()
+{
+	Claim current = claim_.load(std::memory_order_acquire);
+	Claim next;
+	do {
+		next = current;
+		if (next.rests == 0) {
+			next.firstRest = current.played;
+		}
+		next.rests++;
+		next.played++;
+	} while (!claim_.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire));
+
+	return Step {current.played, current.epoch, (position_ + 1) % length_, {-1, 0.0f}};
+}
+
+void ArpLookahead::fill()
+{
+	// a step at a time, letting go in between so that the audio thread can have the arpeggiator if it needs it
+	while (!busy_.test_and_set(std::memory_order_acquire)) {
+		catchUp();
+		int ahead = (int16_t)(generated_ - claim_.load(std::memory_order_acquire).played);
+		bool more = ahead < (int)steps_ && queue_.size() < 2 * kMaxSteps;
+		if (more) {
+			queue_.push(generateStep());
+		}
+		busy_.clear(std::memory_order_release);
+
+		if (!more) {
+			return;
+		}
+	}
+}
+
+bool ArpLookahead::needsFill() const
+{
+	return changes_.load(std::memory_order_relaxed) != applied_.load(std::memory_order_relaxed) ||
+		   queue_.size() < steps_;
+}
+
+void ArpLookahead::catchUp()
+{
+	// with settings to apply, or rests to account for, move the epoch on so that no queued step can be played
+	unsigned int changes = changes_.load(std::memory_order_acquire);
+	bool changed = changes != applied_.load(std::memory_order_relaxed);
+	Claim current = claim_.load(std::memory_order_acquire);
+	bool stale = false;
+	while (!stale && (changed || current.rests > 0)) {
+		Claim next = current;
+		next.epoch++;
+		next.rests = 0;
+		stale = claim_.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire);
+	}
+
+	if (stale) {
+		epoch_ = current.epoch + 1;
+
+		// undo the steps that were never played, and any a rest was played in place of, newest first
+		uint16_t kept = current.rests > 0 ? current.firstRest : current.played;
+		while ((int16_t)(generated_ - kept) > 0) {
+			generated_--;
+			arp_.restoreStepState(undo_[generated_ % (2 * kMaxSteps)]);
+		}
+
+		if (changed) {
+			applySettings();
+			applied_.store(changes, std::memory_order_release);
+		}
+	}
+
+	// beat on past the rests
+	while ((int16_t)(current.played - generated_) > 0) {
+		arp_.beat();
+		generated_++;
+	}
+}
+
+void ArpLookahead::applySettings()
+{
+	// a reset goes first, to the seed as it was asked for, as if it had been made straight away
+	if (resetPending_.exchange(false, std::memory_order_relaxed)) {
+		applySeeds(resetSeed1_.load(std::memory_order_relaxed), resetSeed2_.load(std::memory_order_relaxed), 
+				   resetSeedBalance_.load(std::memory_order_relaxed));
+		arp_.resetToSeed();
+	}
+	applySeeds(seed1_.load(std::memory_order_relaxed), seed2_.load(std::memory_order_relaxed), 
+			   seedBalance_.load(std::memory_order_relaxed));
+
+	// the rest are cheap, and setting them again changes nothing
+	arp_.setTempDistChoice(tempDist_.load(std::memory_order_relaxed));
+	for (unsigned int n = 0; n < kNumTemps; n++) {
+		(arp_.*kTempSetters[n])(temps_[n].load(std::memory_order_relaxed));
+	}
+	arp_.keyChange(key_.load(std::memory_order_relaxed));
+	arp_.modeChange(mode_.load(std::memory_order_relaxed));
+	if (playing_.load(std::memory_order_relaxed)) {
+		arp_.play();
+	}
+	else {
+		arp_.stop();
+	}
+}
+
+void ArpLookahead::applySeeds(int seed1, int seed2, float balance)
+{
+	// the balance first, so that new seeds are only interpolated once
+	if (balance != arp_.getSeedBalance()) {
+		arp_.setSeedBalance(balance);
+	}
+	if (seed1 != appliedSeed1_ || seed2 != appliedSeed2_) {
+		arp_.setSeed(seed1, seed2);
+		appliedSeed1_ = seed1;
+		appliedSeed2_ = seed2;
+	}
+}
+
+ArpLookahead::Step ArpLookahead::generateStep()
+{
+	undo_[generated_ % (2 * kMaxSteps)] = arp_.saveStepState();
+	Step step {generated_, epoch_, 0, {-1, 0.0f}};
+	generated_++;
+
+	arp_.beat();
+	step.position = arp_.getSequencePosition();
+	if (arp_.isPlaying()) {
+		step.noteAmp = arp_.generate();
+	}
+	return step;
+}
+
+void ArpLookahead::setTemp(Temp temp, float value)
+{
+	if (temps_[temp].exchange(value, std::memory_order_relaxed) != value) {
+		changed();
+	}
+}
+
+void ArpLookahead::changeAllTempsByProportion(float proportion)
+{
+	for (unsigned int n = 0; n < kNumTemps; n++) {
+		float temp = temps_[n].load(std::memory_order_relaxed);
+		temps_[n].store(ProbabilisticArp::changeTempByProportion(temp, proportion), std::memory_order_relaxed);
+	}
+	changed();
+}
+
+float ArpLookahead::getOverallTemp() const
+{
+	float temps[kNumTemps];
+	for (unsigned int n = 0; n < kNumTemps; n++) {
+		temps[n] = temps_[n].load(std::memory_order_relaxed);
+	}
+	return ProbabilisticArp::overallTemp(temps);
+}
+
+void ArpLookahead::setSeed(int seed1, int seed2)
+{
+	bool different = seed1_.exchange(seed1, std::memory_order_relaxed) != seed1;
+	different |= seed2_.exchange(seed2, std::memory_order_relaxed) != seed2;
+	if (different) {
+		changed();
+	}
+}
+
+void ArpLookahead::setSeedBalance(float balance)
+{
+	if (seedBalance_.exchange(balance, std::memory_order_relaxed) != balance) {
+		changed();
+	}
+}
+
+void ArpLookahead::setTempDistChoice(unsigned int choice)
+{
+	// checked here, rather than by whichever thread applies it
+	if (choice >= arp_.getNumTempDists()) {
+		throw std::invalid_argument("Invalid argument to 'setTempDistChoice': choice");
+	}
+	if (tempDist_.exchange(choice, std::memory_order_relaxed) != choice) {
+		changed();
+	}
+}
+
+// the looper sends the key and mode with every note, so only actual changes count
+void ArpLookahead::keyChange(unsigned int key)
+{
+	if (key_.exchange(key, std::memory_order_relaxed) != key) {
+		changed();
+	}
+}
+
+void ArpLookahead::modeChange(unsigned int mode)
+{
+	if (mode_.exchange(mode, std::memory_order_relaxed) != mode) {
+		changed();
+	}
+}
+
+unsigned int ArpLookahead::getMode() const {return mode_.load(std::memory_order_relaxed); }
+
+void ArpLookahead::play()
+{
+	if (!playing_.exchange(true, std::memory_order_relaxed)) {
+		changed();
+	}
+}
+
+void ArpLookahead::stop()
+{
+	if (playing_.exchange(false, std::memory_order_relaxed)) {
+		changed();
+	}
+}
+
+bool ArpLookahead::isPlaying() const {return playing_.load(std::memory_order_relaxed); }
+
+void ArpLookahead::resetToSeed()
+{
+	resetSeed1_.store(seed1_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	resetSeed2_.store(seed2_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	resetSeedBalance_.store(seedBalance_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	resetPending_.store(true, std::memory_order_relaxed);
+	changed();
+}
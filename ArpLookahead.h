@@ -0,0 +1,162 @@
+/***** ArpLookahead.h *****/
+
+/*
+Generates the arpeggiator's steps ahead of time in a low priority thread (a Bela
+auxiliary task calling fill()), so that when a sub-beat lands the audio thread only
+takes a finished step off a queue instead of running generate().
+
+Only the thread holding a flag (busy_) ever touches the arpeggiator: the worker for one
+step at a time, or the audio thread when no step is ready. Other threads change the
+settings through the setters here, which mirror the arpeggiator's own. They only record
+the new value, and whoever next holds the flag applies it before generating anything.
+
+The steps pass through a wait-free single producer, single consumer queue, each tagged
+with its index in the sequence of steps and with an epoch. The audio thread takes a
+step by moving a single atomic claim word on from that (index, epoch) to the next index,
+so taking a step and counting it as played are one action, and a step the claim has
+already moved past cannot be played. Applying new settings moves the epoch on in the
+same word, leaving the queued steps unclaimable. Generating a step changes the
+arpeggiator's history, so the state before each one is kept in an undo log: the steps
+that were never played are undone, newest first, and the sequence carries on from the
+last step actually played under the new settings.
+
+When no step is ready (straight after a change, or if the worker falls behind) the
+audio thread generates the step itself, as it would without lookahead. If the worker
+holds the flag at that moment, the audio thread takes a queued step made under the old
+settings if there is one, and otherwise plays a rest in that step's place; the rest is
+recorded in the claim word, and the next holder undoes the step it replaced.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+#include "ProbabilisticArp.h"
+#include "SpscQueue.h"
+
+class ArpLookahead {
+public:
+	static const unsigned int kMaxSteps = 16;		// most steps generated ahead
+
+	// one arpeggiator step: beat() then generate()
+	struct Step {
+		uint16_t index;						// steps before it, counting rests (wraps)
+		uint16_t epoch;						// settings it was generated under
+		unsigned int position;				// sequence position after the beat
+		std::pair<int, float> noteAmp;		// note (-1 for none) and amplitude
+	};
+
+	// takes its settings from the arpeggiator, which must not be changed directly afterwards
+	// (other than by setSeedBank(), before any step is taken, followed by setSeed() here)
+	ArpLookahead(ProbabilisticArp& arp, unsigned int steps = 8);
+
+	// audio thread: the next step
+	Step next();
+
+	// worker thread: apply any new settings, undo any steps made stale, then generate up to the lookahead
+	void fill();
+
+	// whether fill() has anything to do (cheap: for deciding whether to schedule the worker)
+	bool needsFill() const;
+
+	// any thread: the arpeggiator's settings, applied before the next step generated
+	void setIntervalTemp(float temp) {setTemp(kIntervalTemp, temp); }
+	void setContourTemp(float temp) {setTemp(kContourTemp, temp); }
+	void setRhythmicTemp(float temp) {setTemp(kRhythmicTemp, temp); }
+	void setSparsity(float temp) {setTemp(kSparsity, temp); }
+	void setConsistency(float temp) {setTemp(kConsistency, temp); }
+	void setMovement(float temp) {setTemp(kMovement, temp); }
+	void setHarmonicTemp(float temp) {setTemp(kHarmonicTemp, temp); }
+	void setDynamicTemp(float temp) {setTemp(kDynamicTemp, temp); }
+	void setDynamicContourTemp(float temp) {setTemp(kDynamicContourTemp, temp); }
+	void setPitchTemp(float temp) {setTemp(kPitchTemp, temp); }
+	void changeAllTempsByProportion(float proportion);
+	float getOverallTemp() const;
+
+	void setSeed(int seed1, int seed2);
+	void setSeedBalance(float balance);
+	void setTempDistChoice(unsigned int choice);
+	void keyChange(unsigned int key);
+	void modeChange(unsigned int mode);
+	unsigned int getMode() const;
+	void play();
+	void stop();
+	bool isPlaying() const;
+	void resetToSeed();						// reset the previous sequence to the seed as set now
+
+	~ArpLookahead() {};
+
+private:
+	// the temperatures, in the order ProbabilisticArp::overallTemp() takes them
+	enum Temp {
+		kIntervalTemp,
+		kContourTemp,
+		kRhythmicTemp,
+		kSparsity,
+		kConsistency,
+		kMovement,
+		kHarmonicTemp,
+		kDynamicTemp,
+		kDynamicContourTemp,
+		kPitchTemp,
+		kNumTemps
+	};
+	static float (ProbabilisticArp::*const kTempGetters[kNumTemps])();
+	static void (ProbabilisticArp::*const kTempSetters[kNumTemps])(float);
+
+	void setTemp(Temp temp, float value);
+	void changed() {changes_.fetch_add(1, std::memory_order_release); }
+
+	// steps played and the epoch of the steps that may be played, changed only as a whole
+	struct alignas(8) Claim {
+		uint16_t played;					// steps taken by the audio thread, including rests (wraps)
+		uint16_t epoch;
+		uint16_t rests;						// rests played while the flag was held, not yet undone
+		uint16_t firstRest;					// index of the first of them
+	};
+
+	// audio thread: count a step as played, if the claim word is still at it
+	bool claim(const Step& step);
+	bool claimQueued(Step& step);			// take the first queued step that can still be played, dropping any before it
+	Step claimRest();						// play a rest in place of the next step
+
+	// these need the busy_ flag
+	void catchUp();							// apply the settings and bring the arpeggiator up to date with what has been played
+	void applySettings();
+	void applySeeds(int seed1, int seed2, float balance);
+	Step generateStep();
+
+	ProbabilisticArp& arp_;
+	unsigned int steps_;					// lookahead in steps
+	unsigned int length_;					// sequence length
+
+	SpscQueue<Step, 2 * kMaxSteps> queue_;	// room for a full lookahead of stale steps as well
+	ProbabilisticArp::StepState undo_[2 * kMaxSteps];		// state before step n, at n modulo the size (which divides 65536)
+	uint16_t generated_;					// steps generated, including any not yet undone (wraps)
+	uint16_t epoch_;						// epoch of the steps being generated
+	std::atomic<Claim> claim_;
+	std::atomic_flag busy_ = ATOMIC_FLAG_INIT;	// set while a thread is changing the arpeggiator
+
+	// the settings as last set, and the count of changes to them
+	std::atomic<float> temps_[kNumTemps];
+	std::atomic<int> seed1_;
+	std::atomic<int> seed2_;
+	std::atomic<float> seedBalance_;
+	std::atomic<unsigned int> tempDist_;
+	std::atomic<unsigned int> key_;
+	std::atomic<unsigned int> mode_;
+	std::atomic<bool> playing_;
+	std::atomic<bool> resetPending_;
+	std::atomic<int> resetSeed1_;			// the seeds when the reset was asked for
+	std::atomic<int> resetSeed2_;
+	std::atomic<float> resetSeedBalance_;
+	std::atomic<unsigned int> changes_;
+
+	// need the busy_ flag to change
+	std::atomic<unsigned int> applied_;		// the count of changes the arpeggiator has
+	int appliedSeed1_;						// seeds it has
+	int appliedSeed2_;
+
+	int position_;							// audio thread: position of the last step played
+};
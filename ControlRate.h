@@ -0,0 +1,47 @@
+/***** ControlRate.h *****/
+
+/*
+Control-rate modulation: the envelopes and the filter coefficients they drive are
+evaluated once every kControlPeriod samples, and ramped linearly in between so that
+the result is still smooth at audio rate. kControlPeriod is the one switch for the
+whole synth (1 = audio rate, 8, 16 or 32 for lower cost).
+
+Envelopes that run at control rate must be set up with the control rate,
+sampleRate / kControlPeriod, so that their times stay right.
+*/
+
+#pragma once
+
+#include "Denormals.h"
+
+const unsigned int kControlPeriod = 16;		// samples per control update
+
+// A value set every kControlPeriod samples, ramped linearly to each new target
+class ControlRamp {
+public:
+	ControlRamp() : value_(0), step_(0) {}
+
+	// jump straight to a value
+	void reset(float value) {
+		value_ = value;
+		step_ = 0;
+	}
+
+	// ramp from the current value to target over the next kControlPeriod samples
+	// (envelope tails too small to hear are taken as 0, before they become subnormal)
+	void setTarget(float target) {
+		step_ = (flushDenormal(target) - value_) / kControlPeriod;
+	}
+
+	// advance one sample
+	float process() {
+		value_ += step_;
+		return value_;
+	}
+
+	float getValue() const {return value_; }
+
+private:
+	float value_;		// current value
+	float step_;		// change per sample
+};
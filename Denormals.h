@@ -0,0 +1,78 @@
+/***** Denormals.h *****/
+
+/*
+Protection against subnormal (denormal) floats, which are many times slower to
+process on most CPUs. Filter states and envelope tails decay into that range as the
+instrument goes quiet, so without protection the CPU load rises exactly when
+nothing can be heard.
+
+ScopedFlushDenormals switches the current thread to flush-to-zero (and
+denormals-are-zero, where the architecture has it) for its lifetime:
+	x86 (SSE)		MXCSR FTZ and DAZ bits
+	ARMv7 (VFP)		FPSCR FZ bit (NEON arithmetic always flushes)
+	AArch64			FPCR FZ bit
+Anywhere else it does nothing, and flushDenormal() on the state that decays is the
+only protection, which is why the DSP code does both.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define DENORMALS_SSE 1
+#elif defined(__aarch64__)
+#define DENORMALS_AARCH64 1
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define DENORMALS_VFP 1
+#endif
+
+// states smaller than this (about -300 dB) are flushed to zero
+const float kDenormalThreshold = 1e-15f;
+
+// zero a value too small to be heard
+inline float flushDenormal(float x)
+{
+	return std::fabs(x) < kDenormalThreshold ? 0.0f : x;
+}
+
+// Flush to zero on the current thread until the end of the scope
+class ScopedFlushDenormals {
+public:
+	ScopedFlushDenormals()
+	{
+#if DENORMALS_SSE
+		previous_ = _mm_getcsr();
+		_mm_setcsr(previous_ | 0x8040);		// FTZ (bit 15) and DAZ (bit 6)
+#elif DENORMALS_AARCH64
+		asm volatile("mrs %0, fpcr" : "=r"(previous_));
+		asm volatile("msr fpcr, %0" : : "r"(previous_ | (1 << 24)));
+#elif DENORMALS_VFP
+		asm volatile("vmrs %0, fpscr" : "=r"(previous_));
+		asm volatile("vmsr fpscr, %0" : : "r"(previous_ | (1 << 24)));
+#endif
+	}
+
+	~ScopedFlushDenormals()
+	{
+#if DENORMALS_SSE
+		_mm_setcsr(previous_);
+#elif DENORMALS_AARCH64
+		asm volatile("msr fpcr, %0" : : "r"(previous_));
+#elif DENORMALS_VFP
+		asm volatile("vmsr fpscr, %0" : : "r"(previous_));
+#endif
+	}
+
+	ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+	ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+private:
+#if DENORMALS_AARCH64
+	uint64_t previous_;		// control register before the scope
+#else
+	uint32_t previous_;
+#endif
+};
@@ -0,0 +1,126 @@
+/***** FastMath.h *****/
+
+/*
+Fast approximations of tanh, exp2, log2 and pow for the DSP code, for single floats
+and for simd::float4. The vector versions are built on Simd.h, so the backend (NEON,
+SSE2 or plain scalar with SIMD_SCALAR) is chosen at build time with the rest of the
+SIMD code; the single float versions are plain C++ and build anywhere.
+
+Error bounds (measured with tools/FastMathBench.cpp):
+	tanh	within 1e-4 (rational approximation, clamped to +-1 beyond |x| = 4.97)
+	exp2	relative error within 2e-7, for x in [-126, 126] (clamped outside)
+	log2	within 2e-6, for x > 0 (0 gives about -127 rather than -infinity)
+	pow		x > 0: relative error within 2e-6 * |y * log2(x)|
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "Simd.h"
+
+namespace fastmath {
+
+// polynomial coefficients, fitted at Chebyshev nodes
+namespace coefficients {
+	// 2^f for f in [0, 1)
+	const float kExp2[6] = {0.999999898f, 0.69315449f, 0.240141818f, 0.0558603371f, 0.00894959042f, 0.00189375406f};
+	// log2(1 + t) / t for t in [0, 1)
+	const float kLog2[7] = {1.44269298f, -0.721144092f, 0.477496364f, -0.338377198f, 0.213943212f, -0.0946268097f, 0.02001665f};
+	// limit of the tanh approximation, where it reaches 1
+	const float kTanhLimit = 4.97f;
+}
+
+/*** single floats ***/
+
+inline float tanh(float x)
+{
+	x = x > coefficients::kTanhLimit ? coefficients::kTanhLimit : (x < -coefficients::kTanhLimit ? -coefficients::kTanhLimit : x);
+	float x2 = x * x;
+	// continued fraction expansion of tanh, truncated to a 7/6 rational function
+	return x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2))) / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+}
+
+inline float exp2(float x)
+{
+	using namespace coefficients;
+	x = x > 126.0f ? 126.0f : (x < -126.0f ? -126.0f : x);
+	// split into integer and fractional parts: the integer part goes straight into the exponent bits
+	// (the biased value is positive, so truncation rounds down)
+	int32_t exponent = (int32_t)(x + 127.0f);
+	float f = x - ((float)exponent - 127.0f);
+	int32_t bits = exponent << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(float));
+	return scale * (kExp2[0] + f * (kExp2[1] + f * (kExp2[2] + f * (kExp2[3] + f * (kExp2[4] + f * kExp2[5])))));
+}
+
+inline float log2(float x)
+{
+	using namespace coefficients;
+	int32_t bits;
+	memcpy(&bits, &x, sizeof(float));
+	// exponent, plus the log of the mantissa (in [1, 2))
+	float exponent = (float)((bits >> 23) - 127);
+	bits = (bits & 0x007fffff) | 0x3f800000;
+	float mantissa;
+	memcpy(&mantissa, &bits, sizeof(float));
+	float t = mantissa - 1.0f;
+	return exponent + t * (kLog2[0] + t * (kLog2[1] + t * (kLog2[2] + t * (kLog2[3] + t * (kLog2[4] + t * (kLog2[5] + t * kLog2[6]))))));
+}
+
+// x to the power y, for x > 0
+inline float pow(float x, float y)
+{
+	return fastmath::exp2(y * fastmath::log2(x));
+}
+
+/*** 4 lanes ***/
+
+inline simd::float4 tanh(simd::float4 x)
+{
+	using simd::float4;
+	x = simd::max(simd::min(x, float4::set1(coefficients::kTanhLimit)), float4::set1(-coefficients::kTanhLimit));
+	float4 x2 = x * x;
+	float4 numerator = x * (float4::set1(135135.0f) + x2 * (float4::set1(17325.0f) + x2 * (float4::set1(378.0f) + x2)));
+	float4 denominator = float4::set1(135135.0f) + x2 * (float4::set1(62370.0f) + x2 * (float4::set1(3150.0f) + x2 * float4::set1(28.0f)));
+	return numerator / denominator;
+}
+
+inline simd::float4 exp2(simd::float4 x)
+{
+	using namespace coefficients;
+	using simd::float4;
+	x = simd::max(simd::min(x, float4::set1(126.0f)), float4::set1(-126.0f));
+	// the biased value is positive, so truncation rounds down
+	simd::int4 exponent = simd::truncate(x + float4::set1(127.0f));
+	float4 f = x - (simd::toFloat(exponent) - float4::set1(127.0f));
+	float4 scale = simd::asFloat(simd::shiftLeft<23>(exponent));
+	float4 p = float4::set1(kExp2[5]);
+	for (int i = 4; i >= 0; i--) {
+		p = float4::set1(kExp2[i]) + f * p;
+	}
+	return scale * p;
+}
+
+inline simd::float4 log2(simd::float4 x)
+{
+	using namespace coefficients;
+	using simd::float4;
+	using simd::int4;
+	int4 bits = simd::asInt(x);
+	float4 exponent = simd::toFloat(simd::shiftRight<23>(bits)) - float4::set1(127.0f);
+	float4 t = simd::asFloat((bits & int4::set1(0x007fffff)) | int4::set1(0x3f800000)) - float4::set1(1.0f);
+	float4 p = float4::set1(kLog2[6]);
+	for (int i = 5; i >= 0; i--) {
+		p = float4::set1(kLog2[i]) + t * p;
+	}
+	return exponent + t * p;
+}
+
+inline simd::float4 pow(simd::float4 x, simd::float4 y)
+{
+	return fastmath::exp2(y * fastmath::log2(x));
+}
+
+} // namespace fastmath
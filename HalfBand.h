@@ -0,0 +1,128 @@
+/***** HalfBand.h *****/
+
+/*
+Polyphase half-band FIR filters for 2x oversampling, working on 4 independent
+channels at once (one per simd::float4 lane).
+
+A half-band filter has a centre tap of 0.5 and every other tap zero, so it splits
+into two phases: one is a plain delay and the other a symmetric FIR of the odd taps.
+The upsampler computes the two output phases of each input sample, and the
+downsampler the one output of each pair of input samples, without ever multiplying
+by the stuffed zeros or computing the discarded outputs.
+
+The designs (Kaiser windowed sinc) are template parameters, as the interpolation
+policies are for the oscillators:
+	HalfBandSteep	39 taps, passband to 0.2 of the high rate, stopband 63 dB down from 0.3
+	HalfBandShort	15 taps, passband to 0.1 of the high rate, stopband 69 dB down from 0.4
+so 4x oversampling uses HalfBandSteep for the first stage and HalfBandShort for the
+second, where the signal only fills the bottom quarter of the band.
+*/
+
+#pragma once
+
+#include "Simd.h"
+
+// odd taps either side of the centre, nearest first
+struct HalfBandSteep {
+	static const unsigned int kPairs = 10;
+	static float coefficient(unsigned int j)
+	{
+		static const float coefficients[kPairs] = {0.316151763f, -0.0995375021f, 0.0531946348f, -0.0318047934f, 0.0193455259f,
+												   -0.0114563623f, 0.00639452051f, -0.00324338171f, 0.00140833601f, -0.000452740788f};
+		return coefficients[j];
+	}
+};
+
+struct HalfBandShort {
+	static const unsigned int kPairs = 4;
+	static float coefficient(unsigned int j)
+	{
+		static const float coefficients[kPairs] = {0.301016088f, -0.0633626578f, 0.0136726677f, -0.00132609836f};
+		return coefficients[j];
+	}
+};
+
+// delay line of the last 2 * kPairs samples, written twice so that reads never wrap
+template <class Design>
+class HalfBandDelay {
+public:
+	static const unsigned int kLength = 2 * Design::kPairs;
+
+	HalfBandDelay() {reset(); }
+
+	void reset()
+	{
+		for (unsigned int i = 0; i < 2 * kLength; i++) {
+			history_[i] = simd::float4::set1(0);
+		}
+		position_ = 0;
+	}
+
+	void write(simd::float4 in)
+	{
+		position_ = (position_ == 0 ? kLength : position_) - 1;
+		history_[position_] = in;
+		history_[position_ + kLength] = in;
+	}
+
+	// the sample written delay writes ago
+	simd::float4 read(unsigned int delay) const {return history_[position_ + delay]; }
+
+	// the symmetric FIR of the odd taps, centred between delays kPairs - 1 and kPairs
+	simd::float4 convolve() const
+	{
+		const simd::float4* centre = &history_[position_ + Design::kPairs];
+		simd::float4 sum = simd::float4::set1(0);
+		for (unsigned int j = 0; j < Design::kPairs; j++) {
+			sum = sum + simd::float4::set1(Design::coefficient(j)) * (centre[-1 - (int)j] + centre[j]);
+		}
+		return sum;
+	}
+
+private:
+	simd::float4 history_[2 * kLength];
+	unsigned int position_;		// index of the newest sample
+};
+
+// one sample in, two out
+template <class Design>
+class HalfBandUpsampler {
+public:
+	void reset() {delay_.reset(); }
+
+	// out0 then out1 follow in at the high rate
+	void process(simd::float4 in, simd::float4& out0, simd::float4& out1)
+	{
+		delay_.write(in);
+		// the zeros stuffed between samples halve the level, so the taps are doubled
+		const simd::float4 two = simd::float4::set1(2);
+		out0 = two * delay_.convolve();
+		out1 = delay_.read(Design::kPairs - 1);
+	}
+
+private:
+	HalfBandDelay<Design> delay_;
+};
+
+// two samples in, one out
+template <class Design>
+class HalfBandDownsampler {
+public:
+	void reset()
+	{
+		even_.reset();
+		odd_.reset();
+	}
+
+	// in0 then in1 at the high rate
+	simd::float4 process(simd::float4 in0, simd::float4 in1)
+	{
+		even_.write(in0);
+		odd_.write(in1);
+		return simd::float4::set1(0.5) * even_.read(Design::kPairs - 1) + odd_.convolve();
+	}
+
+private:
+	HalfBandDelay<Design> even_;		// samples in0
+	HalfBandDelay<Design> odd_;			// samples in1
+};
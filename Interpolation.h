@@ -0,0 +1,88 @@
+/***** Interpolation.h *****/
+
+/*
+Interpolation policies for reading single-cycle wavetables, used as template parameters
+of the wavetable oscillators so that the choice costs nothing in the inner loop.
+Each policy reads 4 voices at once: index[] holds each voice's table index and
+fraction the position between that index and the next. Reads wrap around the table
+(indexMask is the table length - 1).
+
+From cheapest to best quality: NoInterpolation, LinearInterpolation,
+HermiteInterpolation (4-point cubic) and LagrangeInterpolation (4-point, 3rd order).
+The cubic policies keep tables of a given size much cleaner, so they can be used to
+shrink the tables instead.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "Simd.h"
+
+// read the samples at an offset from each voice's index
+static inline simd::float4 gatherTable(const float* table, const uint32_t* index, uint32_t indexMask, int offset)
+{
+	float samples[simd::kLanes];
+	for (unsigned int i = 0; i < simd::kLanes; i++) {
+		samples[i] = table[(index[i] + offset) & indexMask];
+	}
+	return simd::float4::load(samples);
+}
+
+// Read the table without interpolation
+struct NoInterpolation {
+	static simd::float4 read(const float* table, const uint32_t* index, uint32_t indexMask, simd::float4 /*fraction*/)
+	{
+		return gatherTable(table, index, indexMask, 0);
+	}
+};
+
+// weighted average of the samples either side of the position
+struct LinearInterpolation {
+	static simd::float4 read(const float* table, const uint32_t* index, uint32_t indexMask, simd::float4 fraction)
+	{
+		simd::float4 below = gatherTable(table, index, indexMask, 0);
+		simd::float4 above = gatherTable(table, index, indexMask, 1);
+		return below + fraction * (above - below);
+	}
+};
+
+// 4-point cubic Hermite (Catmull-Rom) through the two samples either side of the position
+struct HermiteInterpolation {
+	static simd::float4 read(const float* table, const uint32_t* index, uint32_t indexMask, simd::float4 fraction)
+	{
+		simd::float4 ym1 = gatherTable(table, index, indexMask, -1);
+		simd::float4 y0 = gatherTable(table, index, indexMask, 0);
+		simd::float4 y1 = gatherTable(table, index, indexMask, 1);
+		simd::float4 y2 = gatherTable(table, index, indexMask, 2);
+		const simd::float4 half = simd::float4::set1(0.5);
+
+		simd::float4 c1 = half * (y1 - ym1);
+		simd::float4 c2 = ym1 - simd::float4::set1(2.5) * y0 + simd::float4::set1(2.0) * y1 - half * y2;
+		simd::float4 c3 = half * (y2 - ym1) + simd::float4::set1(1.5) * (y0 - y1);
+		return ((c3 * fraction + c2) * fraction + c1) * fraction + y0;
+	}
+};
+
+// 4-point, 3rd order Lagrange polynomial through the two samples either side of the position
+struct LagrangeInterpolation {
+	static simd::float4 read(const float* table, const uint32_t* index, uint32_t indexMask, simd::float4 fraction)
+	{
+		simd::float4 ym1 = gatherTable(table, index, indexMask, -1);
+		simd::float4 y0 = gatherTable(table, index, indexMask, 0);
+		simd::float4 y1 = gatherTable(table, index, indexMask, 1);
+		simd::float4 y2 = gatherTable(table, index, indexMask, 2);
+		const simd::float4 one = simd::float4::set1(1.0);
+		const simd::float4 two = simd::float4::set1(2.0);
+
+		// distances from each of the points at -1, 0, 1 and 2
+		simd::float4 dm1 = fraction + one;
+		simd::float4 d1 = fraction - one;
+		simd::float4 d2 = fraction - two;
+
+		simd::float4 wm1 = simd::float4::set1(-1.0 / 6.0) * fraction * d1 * d2;
+		simd::float4 w0 = simd::float4::set1(0.5) * dm1 * d1 * d2;
+		simd::float4 w1 = simd::float4::set1(-0.5) * dm1 * fraction * d2;
+		simd::float4 w2 = simd::float4::set1(1.0 / 6.0) * dm1 * fraction * d1;
+		return wm1 * ym1 + w0 * y0 + w1 * y1 + w2 * y2;
+	}
+};
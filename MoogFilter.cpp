@@ -3,10 +3,10 @@
 #include "MoogFilter.h"
 
 #include <cmath>
-#include <vector>
-#include <libraries/math_neon/math_neon.h>
+#include <stdexcept>
 
-#include "FirstOrderFilter.h"
+#include "FastMath.h"
+#include "Denormals.h"
 
 MoogFilter::MoogFilter() 
 {
@@ -21,74 +21,190 @@ MoogFilter::MoogFilter(float sampleRate, int type)
 void MoogFilter::setup(float sampleRate, int type, float compensation)
 {
 	sampleRate_ = sampleRate;
-	type_ = type;
+	omegaScale_ = 2 * M_PI / sampleRate_;
+	set_type(type);
 	
 	res_ = 0.75;
 	comp_ = compensation;
 	
-	// initialise first order sections
-	for (unsigned int n = 0; n < 4; n++) {
-		filterSections_.push_back(FirstOrderFilter());
-	}
-	// initialise section outputs (including input after non-linearity)
-	for (unsigned int n = 0; n < 5; n++) {
-		sectionOuts_.push_back(0);
-	}	
+	// no coefficients calculated yet
+	frequency_ = -1;
+	resonance_ = -1;
+	g_ = 0;
+	gStep_ = 0;
+	resStep_ = 0;
+	rampFrames_ = 0;
+	
+	// sections pass the signal straight through until set_params is called
+	a1_ = 0;
+	b0_ = 1;
+	b1_ = 0;
+	
+	// clear filter state
+	sectionOuts_.fill(0);
 }
 
 void MoogFilter::set_type(int type) 
 {
+	switch (type) {
+		case kLowpass6:
+			process_ = &MoogFilter::process_type<kLowpass6>;
+			processBlock_ = &MoogFilter::process_block_type<kLowpass6>;
+			break;
+		case kLowpass12:
+			process_ = &MoogFilter::process_type<kLowpass12>;
+			processBlock_ = &MoogFilter::process_block_type<kLowpass12>;
+			break;
+		case kBandpass6:
+			process_ = &MoogFilter::process_type<kBandpass6>;
+			processBlock_ = &MoogFilter::process_block_type<kBandpass6>;
+			break;
+		case kBandpass12:
+			process_ = &MoogFilter::process_type<kBandpass12>;
+			processBlock_ = &MoogFilter::process_block_type<kBandpass12>;
+			break;
+		case kHighpass6:
+			process_ = &MoogFilter::process_type<kHighpass6>;
+			processBlock_ = &MoogFilter::process_block_type<kHighpass6>;
+			break;
+		case kHighpass12:
+			process_ = &MoogFilter::process_type<kHighpass12>;
+			processBlock_ = &MoogFilter::process_block_type<kHighpass12>;
+			break;
+		default:
+			throw std::invalid_argument("Invalid argument to 'set_type': type");
+	}
 	type_ = type;
 }
 
-void MoogFilter::set_params(float frequencyHz, float resonance, float compensation) 
+// calculate g and Gres for a cutoff and resonance
+void MoogFilter::calculate_coefficients(float frequencyHz, float resonance, float& g, float& res)
 {
-	// calculate g (polynomial approximation of cutoff frequency)
-	float omega = 2 * M_PI * frequencyHz  / sampleRate_;			// normalised angular frequency in radians
-	float g = 0.9892 * omega - 0.4342 * powf(omega, 2) + 0.1381 * powf(omega, 3) - 0.0202 * powf(omega, 4);
+	// calculate g (polynomial approximation of cutoff frequency, in Horner form)
+	float omega = frequencyHz * omegaScale_;			// normalised angular frequency in radians
+	g = omega * (0.9892f + omega * (-0.4342f + omega * (0.1381f - 0.0202f * omega)));
 	
-	// update Gres (resonance coefficient)
-	res_ = resonance * (1.0029 + 0.0526 * omega - 0.0926 * powf(omega, 2) + 0.0218 * powf(omega, 3));
+	// Gres (resonance coefficient)
+	res = resonance * (1.0029f + omega * (0.0526f + omega * (-0.0926f + 0.0218f * omega)));
+}
+
+void MoogFilter::update_sections()
+{
+	// calculate new coefficients for the first order sections
+	a1_ = g_ - 1;
+	b0_ = g_ / 1.3f;
+	b1_ = 0.3f * g_ / 1.3f;
+}
+
+void MoogFilter::set_params(float frequencyHz, float resonance, float compensation) 
+{
+	// set compensation coefficient
+	comp_ = compensation;
 	
-	// calculate new coefficients for each first order section		
-	float a1 = g - 1;
-	float b0 = g / 1.3;
-	float b1 = 0.3 * g / 1.3;
+	// the envelopes often hold still, so skip the update when nothing has changed
+	if (frequencyHz == frequency_ && resonance == resonance_ && rampFrames_ == 0) {
+		return;
+	}
+	frequency_ = frequencyHz;
+	resonance_ = resonance;
+	rampFrames_ = 0;
 	
-	// update filter coefficients
-	for (unsigned int n = 0; n < filterSections_.size(); n++) {
-		filterSections_[n].set_coefficients(a1, b0, b1);
+	calculate_coefficients(frequencyHz, resonance, g_, res_);
+	update_sections();
+}
+
+void MoogFilter::ramp_params(float frequencyHz, float resonance, unsigned int frames, float compensation)
+{
+	if (frames <= 1) {
+		set_params(frequencyHz, resonance, compensation);
+		return;
 	}
 	
 	// set compensation coefficient
 	comp_ = compensation;
+	
+	frequency_ = frequencyHz;
+	resonance_ = resonance;
+	
+	// g and Gres are stepped by process(): the section coefficients are linear in g
+	float g, res;
+	calculate_coefficients(frequencyHz, resonance, g, res);
+	gStep_ = (g - g_) / frames;
+	resStep_ = (res - res_) / frames;
+	rampFrames_ = frames;
+}
+
+// zero any section output that has decayed below hearing, before it becomes subnormal
+void MoogFilter::flush_denormals()
+{
+	for (unsigned int n = 0; n < sectionOuts_.size(); n++) {
+		sectionOuts_[n] = flushDenormal(sectionOuts_[n]);
+	}
 }
 
 float MoogFilter::process(float in) 
 {
+	return (this->*process_)(in);
+}
+
+void MoogFilter::process_block(const float* in, float* out, unsigned int frames)
+{
+	(this->*processBlock_)(in, out, frames);
+}
+
+template <int Type>
+float MoogFilter::process_type(float in)
+{
+	// move along the coefficient ramp
+	if (rampFrames_ > 0) {
+		g_ += gStep_;
+		res_ += resStep_;
+		update_sections();
+		rampFrames_--;
+	}
+	
 	// add feedback to input signal
 	in = (1 + 4 * res_ * comp_) * in - 4 * res_ * sectionOuts_[4];
 	
 	// apply nonlinearity
-	in = tanhf_neon(in);
+	float x = fastmath::tanh(in);
 	
-	// store value of 'in'
-	sectionOuts_[0] = in;
+	// first order sections: y[n] = b0 * x[n] + b1 * x[n-1] - a1 * y[n-1],
+	// where x[n-1] is the previous output of the section before
+	float y1 = b0_ * x + b1_ * sectionOuts_[0] - a1_ * sectionOuts_[1];
+	float y2 = b0_ * y1 + b1_ * sectionOuts_[1] - a1_ * sectionOuts_[2];
+	float y3 = b0_ * y2 + b1_ * sectionOuts_[2] - a1_ * sectionOuts_[3];
+	float y4 = b0_ * y3 + b1_ * sectionOuts_[3] - a1_ * sectionOuts_[4];
 	
-	// loop through filter sections, applying each section to the signal
-	for (unsigned int n = 0; n < 4; n++) {
-		in = filterSections_[n].process(in);
-		// store signal value
-		sectionOuts_[n + 1] = in;
-	}
+	// store section outputs
+	sectionOuts_[0] = x;
+	sectionOuts_[1] = y1;
+	sectionOuts_[2] = y2;
+	sectionOuts_[3] = y3;
+	sectionOuts_[4] = y4;
 	
-	// initialise final output y[n]
-	float out = 0;	
-	// multiply the outputs from each section by the corresponding coefficients
-	for (unsigned int n = 0; n < 5; n++) {
-		out += sectionOuts_[n] * filterOutCoeffs_[type_][n];
+	// mix the section outputs for the filter type (resolved at compile time)
+	switch (Type) {
+		case kLowpass6:
+			return y2;
+		case kLowpass12:
+			return y4;
+		case kBandpass6:
+			return 2 * y1 - 2 * y2;
+		case kBandpass12:
+			return 4 * y2 - 8 * y3;
+		case kHighpass6:
+			return x - 2 * y1 + y2;
+		default:	// kHighpass12
+			return x - 4 * y1 + 6 * y2 - 4 * y3 + y4;
 	}
-	
-	return out;	
 }
-	
\ No newline at end of file
+
+template <int Type>
+void MoogFilter::process_block_type(const float* in, float* out, unsigned int frames)
+{
+	for (unsigned int n = 0; n < frames; n++) {
+		out[n] = process_type<Type>(in[n]);
+	}
+	flush_denormals();
+}
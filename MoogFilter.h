@@ -1,48 +1,91 @@
 /***** MoogFilter.h *****/
 
 /*
-Emulation of Moog Ladder Filter, according to 
+Emulation of Moog Ladder Filter, according to
 Valimaki & Huovilainen (2006) - Oscillator and Filter Algorithms for Virtual Analog Synthesis
+
+The four first order sections are computed inline, and the filter state is the
+output of each stage on the previous sample. The filter type is a template
+parameter of the processing functions, so each output mix is fixed at compile
+time; set_type() picks the matching instantiation.
 */
 
 #pragma once
 
-#include "FirstOrderFilter.h"
-#include <vector>
+#include <array>
 
 class MoogFilter {
 public:
+	// filter types
+	enum {
+		kLowpass6 = 0,
+		kLowpass12,
+		kBandpass6,
+		kBandpass12,
+		kHighpass6,
+		kHighpass12,
+		kNumTypes
+	};
+
 	MoogFilter();
-	
+
 	MoogFilter(float sampleRate, int type = 0);
-	
+
 	void setup(float sampleRate, int type = 0, float compensation = 0.5);
-	
+
 	void set_type(int type);
-	
+
+	// cheap enough to call every sample: nothing is recalculated if the inputs are unchanged
 	void set_params(float frequencyHz, float resonance, float compensation = 0.5);
-	
+
+	// move the coefficients linearly to those for the new parameters over the next frames samples
+	void ramp_params(float frequencyHz, float resonance, unsigned int frames, float compensation = 0.5);
+
 	float process(float in);
+
+	// filter a block of samples (in and out may be the same buffer)
+	void process_block(const float* in, float* out, unsigned int frames);
 	
+	// zero the filter state once it has decayed below hearing (process_block does this itself)
+	void flush_denormals();
+
 	~MoogFilter() { };
-	
+
 private:
 	float sampleRate_;
+	float omegaScale_;		// 2 pi / sample rate (normalised angular frequency per Hz)
+
+	// inputs of the last set_params call
+	float frequency_;
+	float resonance_;
+
+	// coefficients for a cutoff and resonance
+	void calculate_coefficients(float frequencyHz, float resonance, float& g, float& res);
+	void update_sections();			// set the first order section coefficients from g_
+
+	float g_;					// cutoff coefficient
+	float gStep_;				// change in g_ per sample while ramping
+	float resStep_;				// change in res_ per sample while ramping
+	unsigned int rampFrames_;	// samples left to ramp
+
+	// first order section coefficients (shared by all four sections)
+	float a1_;
+	float b0_;
+	float b1_;
+
+	// section outputs on the previous sample (including input after non-linearity)
+	std::array<float, 5> sectionOuts_;
 
-	std::vector<FirstOrderFilter> filterSections_;
-	
-	std::vector<float> sectionOuts_;
-	
 	float res_;
 	float comp_;
-	
+
 	int type_;
-	
-	// coefficients for filter types
-	const std::vector<std::vector<float>> filterOutCoeffs_ {{0, 0, 1, 0, 0},	// Lowpass 6
-											    		    {0, 0, 0, 0, 1},	// Lowpass 12
-											    		    {0, 2, -2, 0, 0},	// Bandpass 6
-											    		    {0, 0, 4, -8, 0},	// Bandpass 12
-											    		    {1, -2, 1, 0, 0},	// Highpass 6
-											    		    {1, -4, 6, -4, 1}};	// Highpass 12	
+
+	// processing for one filter type
+	template <int Type> float process_type(float in);
+	template <int Type> void process_block_type(const float* in, float* out, unsigned int frames);
+
+	// the instantiations for the current type
+	float (MoogFilter::*process_)(float);
+	void (MoogFilter::*processBlock_)(const float*, float*, unsigned int);
 };
@@ -0,0 +1,325 @@
+/***** MoogFilterBank.cpp *****/
+
+#include "MoogFilterBank.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "Simd.h"
+#include "FastMath.h"
+#include "Denormals.h"
+#include "MoogFilter.h"
+
+using namespace simd;
+
+const unsigned int MoogFilterBank::kLanes;
+constexpr float MoogFilterBank::kSettledLevel;
+
+// weights of the section outputs for each filter type (as in MoogFilter)
+static const float kOutputMix[MoogFilter::kNumTypes][5] {{0, 0, 1, 0, 0},		// Lowpass 6
+														 {0, 0, 0, 0, 1},		// Lowpass 12
+														 {0, 2, -2, 0, 0},		// Bandpass 6
+														 {0, 0, 4, -8, 0},		// Bandpass 12
+														 {1, -2, 1, 0, 0},		// Highpass 6
+														 {1, -4, 6, -4, 1}};	// Highpass 12
+
+MoogFilterBank::MoogFilterBank()
+{
+	setup(1);
+}
+
+MoogFilterBank::MoogFilterBank(float sampleRate, int type)
+{
+	setup(sampleRate, type);
+}
+
+void MoogFilterBank::setup(float sampleRate, int type, float compensation)
+{
+	sampleRate_ = sampleRate;
+
+	for (unsigned int lane = 0; lane < kLanes; lane++) {
+		set_type(lane, type);
+
+		// sections pass the signal straight through until set_params is called
+		g_[lane] = 1;
+		res_[lane] = 0;
+		comp_[lane] = compensation;
+		gStep_[lane] = 0;
+		resStep_[lane] = 0;
+		gTarget_[lane] = 1;
+		resTarget_[lane] = 0;
+		frequency_[lane] = -1;
+		resonance_[lane] = 0;
+		rampFrames_[lane] = 0;
+
+		// clear filter state
+		for (unsigned int n = 0; n < 5; n++) {
+			sectionOuts_[n][lane] = 0;
+		}
+	}
+
+	set_oversampling(1);
+}
+
+void MoogFilterBank::set_type(unsigned int lane, int type)
+{
+	if (lane >= kLanes) {
+		throw std::invalid_argument("Invalid argument to 'set_type': lane");
+	}
+	if (type < 0 || type >= MoogFilter::kNumTypes) {
+		throw std::invalid_argument("Invalid argument to 'set_type': type");
+	}
+	for (unsigned int n = 0; n < 5; n++) {
+		mix_[n][lane] = kOutputMix[type][n];
+	}
+}
+
+void MoogFilterBank::set_oversampling(unsigned int factor)
+{
+	switch (factor) {
+		case 1:
+			processBlock_ = &MoogFilterBank::process_block_factor<1>;
+			break;
+		case 2:
+			processBlock_ = &MoogFilterBank::process_block_factor<2>;
+			break;
+		case 4:
+			processBlock_ = &MoogFilterBank::process_block_factor<4>;
+			break;
+		default:
+			throw std::invalid_argument("Invalid argument to 'set_oversampling': factor");
+	}
+	oversampling_ = factor;
+	omegaScale_ = 2 * M_PI / (sampleRate_ * factor);
+
+	// start the half-band filters from silence
+	upsampler1_.reset();
+	upsampler2_.reset();
+	downsampler1_.reset();
+	downsampler2_.reset();
+
+	// the coefficients depend on the (oversampled) rate
+	for (unsigned int lane = 0; lane < kLanes; lane++) {
+		if (frequency_[lane] >= 0) {
+			set_params(lane, frequency_[lane], resonance_[lane]);
+		}
+	}
+}
+
+// calculate g and Gres for a cutoff and resonance (as in MoogFilter)
+void MoogFilterBank::calculate_coefficients(float frequencyHz, float resonance, float& g, float& res)
+{
+	float omega = frequencyHz * omegaScale_;			// normalised angular frequency in radians
+	g = omega * (0.9892f + omega * (-0.4342f + omega * (0.1381f - 0.0202f * omega)));
+	res = resonance * (1.0029f + omega * (0.0526f + omega * (-0.0926f + 0.0218f * omega)));
+}
+
+void MoogFilterBank::set_params(unsigned int lane, float frequencyHz, float resonance)
+{
+	frequency_[lane] = frequencyHz;
+	resonance_[lane] = resonance;
+	calculate_coefficients(frequencyHz, resonance, gTarget_[lane], resTarget_[lane]);
+	g_[lane] = gTarget_[lane];
+	res_[lane] = resTarget_[lane];
+	gStep_[lane] = 0;
+	resStep_[lane] = 0;
+	rampFrames_[lane] = 0;
+}
+
+void MoogFilterBank::ramp_params(unsigned int lane, float frequencyHz, float resonance, unsigned int frames)
+{
+	if (frames <= 1) {
+		set_params(lane, frequencyHz, resonance);
+		return;
+	}
+
+	frequency_[lane] = frequencyHz;
+	resonance_[lane] = resonance;
+
+	// the section coefficients are linear in g, so g and Gres are stepped by process_block
+	calculate_coefficients(frequencyHz, resonance, gTarget_[lane], resTarget_[lane]);
+	gStep_[lane] = (gTarget_[lane] - g_[lane]) / frames;
+	resStep_[lane] = (resTarget_[lane] - res_[lane]) / frames;
+	rampFrames_[lane] = frames;
+}
+
+bool MoogFilterBank::is_settled(unsigned int lane) const
+{
+	for (unsigned int n = 0; n < 5; n++) {
+		if (std::fabs(sectionOuts_[n][lane]) >= kSettledLevel) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// (the half-band filters are shared by the lanes, but by the time a lane has settled
+// they only hold its last few outputs, which are all below kSettledLevel too)
+void MoogFilterBank::clear(unsigned int lane)
+{
+	for (unsigned int n = 0; n < 5; n++) {
+		sectionOuts_[n][lane] = 0;
+	}
+}
+
+void MoogFilterBank::process_block(const float* const* in, float* const* out, unsigned int frames)
+{
+	(this->*processBlock_)(in, out, frames);
+}
+
+template <unsigned int kFactor>
+void MoogFilterBank::process_block_factor(const float* const* in, float* const* out, unsigned int frames)
+{
+	// null lanes read from a silent input and write to a discarded output, without advancing
+	const float silence = 0;
+	float discard;
+	const float* inputs[kLanes];
+	float* outputs[kLanes];
+	unsigned int inputSteps[kLanes];
+	unsigned int outputSteps[kLanes];
+	for (unsigned int lane = 0; lane < kLanes; lane++) {
+		inputs[lane] = in[lane] ? in[lane] : &silence;
+		inputSteps[lane] = in[lane] ? 1 : 0;
+		outputs[lane] = out[lane] ? out[lane] : &discard;
+		outputSteps[lane] = out[lane] ? 1 : 0;
+	}
+
+	// the filter state and mix are held in registers for the whole block
+	float4 s0 = float4::load(sectionOuts_[0]);
+	float4 s1 = float4::load(sectionOuts_[1]);
+	float4 s2 = float4::load(sectionOuts_[2]);
+	float4 s3 = float4::load(sectionOuts_[3]);
+	float4 s4 = float4::load(sectionOuts_[4]);
+	const float4 m0 = float4::load(mix_[0]);
+	const float4 m1 = float4::load(mix_[1]);
+	const float4 m2 = float4::load(mix_[2]);
+	const float4 m3 = float4::load(mix_[3]);
+	const float4 m4 = float4::load(mix_[4]);
+	const float4 comp = float4::load(comp_);
+
+	const float4 one = float4::set1(1);
+	const float4 four = float4::set1(4);
+	const float4 b0Scale = float4::set1(1 / 1.3f);
+	const float4 b1Scale = float4::set1(0.3f / 1.3f);
+
+	alignas(16) float frame[kLanes];
+
+	unsigned int n = 0;
+	while (n < frames) {
+		// run to the end of the block or of the next ramp to finish
+		unsigned int length = frames - n;
+		for (unsigned int lane = 0; lane < kLanes; lane++) {
+			if (rampFrames_[lane] > 0 && rampFrames_[lane] < length) {
+				length = rampFrames_[lane];
+			}
+		}
+
+		float4 g = float4::load(g_);
+		float4 res = float4::load(res_);
+		const float4 gStep = float4::load(gStep_);
+		const float4 resStep = float4::load(resStep_);
+
+		for (unsigned int k = 0; k < length; k++) {
+			// move along the coefficient ramps
+			g = g + gStep;
+			res = res + resStep;
+
+			// first order section coefficients
+			float4 a1 = g - one;
+			float4 b0 = g * b0Scale;
+			float4 b1 = g * b1Scale;
+
+			float4 feedback = four * res;
+			float4 gain = one + feedback * comp;
+
+			// one step of the ladder, at the oversampled rate
+			auto ladder = [&](float4 x) {
+				// add feedback to input signal and apply nonlinearity
+				x = fastmath::tanh(x * gain - feedback * s4);
+
+				// first order sections: y[n] = b0 * x[n] + b1 * x[n-1] - a1 * y[n-1]
+				float4 y1 = b0 * x + b1 * s0 - a1 * s1;
+				float4 y2 = b0 * y1 + b1 * s1 - a1 * s2;
+				float4 y3 = b0 * y2 + b1 * s2 - a1 * s3;
+				float4 y4 = b0 * y3 + b1 * s3 - a1 * s4;
+				s0 = x;
+				s1 = y1;
+				s2 = y2;
+				s3 = y3;
+				s4 = y4;
+
+				// mix the section outputs for each lane's type
+				return m0 * x + m1 * y1 + m2 * y2 + m3 * y3 + m4 * y4;
+			};
+
+			// gather one sample from each lane
+			for (unsigned int lane = 0; lane < kLanes; lane++) {
+				frame[lane] = *inputs[lane];
+				inputs[lane] += inputSteps[lane];
+			}
+			float4 x = float4::load(frame);
+
+			float4 y;
+			if (kFactor == 1) {
+				y = ladder(x);
+			}
+			else if (kFactor == 2) {
+				float4 up0, up1;
+				upsampler1_.process(x, up0, up1);
+				float4 down0 = ladder(up0);
+				float4 down1 = ladder(up1);
+				y = downsampler1_.process(down0, down1);
+			}
+			else {
+				// two half-band stages each way
+				float4 up0, up1, up00, up01, up10, up11;
+				upsampler1_.process(x, up0, up1);
+				upsampler2_.process(up0, up00, up01);
+				upsampler2_.process(up1, up10, up11);
+				float4 down00 = ladder(up00);
+				float4 down01 = ladder(up01);
+				float4 down10 = ladder(up10);
+				float4 down11 = ladder(up11);
+				float4 down0 = downsampler2_.process(down00, down01);
+				float4 down1 = downsampler2_.process(down10, down11);
+				y = downsampler1_.process(down0, down1);
+			}
+
+			// scatter
+			y.store(frame);
+			for (unsigned int lane = 0; lane < kLanes; lane++) {
+				*outputs[lane] = frame[lane];
+				outputs[lane] += outputSteps[lane];
+			}
+		}
+		n += length;
+
+		// finish any ramps that have run their course, landing exactly on their targets
+		g.store(g_);
+		res.store(res_);
+		for (unsigned int lane = 0; lane < kLanes; lane++) {
+			if (rampFrames_[lane] > 0) {
+				rampFrames_[lane] -= length;
+				if (rampFrames_[lane] == 0) {
+					g_[lane] = gTarget_[lane];
+					res_[lane] = resTarget_[lane];
+					gStep_[lane] = 0;
+					resStep_[lane] = 0;
+				}
+			}
+		}
+	}
+
+	s0.store(sectionOuts_[0]);
+	s1.store(sectionOuts_[1]);
+	s2.store(sectionOuts_[2]);
+	s3.store(sectionOuts_[3]);
+	s4.store(sectionOuts_[4]);
+
+	// a decaying state would otherwise end up subnormal once the input goes quiet
+	for (unsigned int n = 0; n < 5; n++) {
+		for (unsigned int lane = 0; lane < kLanes; lane++) {
+			sectionOuts_[n][lane] = flushDenormal(sectionOuts_[n][lane]);
+		}
+	}
+}
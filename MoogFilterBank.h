@@ -0,0 +1,92 @@
+/***** MoogFilterBank.h *****/
+
+/*
+Several independent Moog ladder filters run in lockstep, one per SIMD lane.
+The ladder recursion is serial within one filter, but separate filters (the left
+and right channels, or different voices) can share the vector instructions, so a
+bank of four costs about the same as one MoogFilter.
+
+Each lane has its own cutoff, resonance and filter type (the MoogFilter types);
+the filter itself is the same as MoogFilter.
+
+The ladder can run 2x or 4x oversampled (set_oversampling), with half-band filters
+either side, to keep the aliasing of the tanh non-linearity out of the audio band
+at high resonance. The setting is per bank: it multiplies the cost of the ladder.
+*/
+
+#pragma once
+
+#include "Simd.h"
+#include "HalfBand.h"
+#include "MoogFilter.h"
+
+class MoogFilterBank {
+public:
+	static const unsigned int kLanes = simd::kLanes;		// number of filters in the bank
+	static constexpr float kSettledLevel = 1e-5;				// state level of a settled lane (-100 dB)
+
+	MoogFilterBank();
+
+	MoogFilterBank(float sampleRate, int type = MoogFilter::kLowpass6);
+
+	// set every lane to the same type
+	void setup(float sampleRate, int type = MoogFilter::kLowpass6, float compensation = 0.5);
+
+	void set_type(unsigned int lane, int type);
+
+	// run the ladder at 1, 2 or 4 times the sample rate
+	void set_oversampling(unsigned int factor);
+
+	void set_params(unsigned int lane, float frequencyHz, float resonance);
+
+	// move the lane's coefficients linearly to those for the new parameters over the next frames samples
+	void ramp_params(unsigned int lane, float frequencyHz, float resonance, unsigned int frames);
+
+	// true once the lane's state has decayed below kSettledLevel, so a silent input can be skipped
+	bool is_settled(unsigned int lane) const;
+
+	// zero the lane's state, to start again from silence
+	void clear(unsigned int lane);
+
+	// filter a block of each lane: in[lane] and out[lane] may be the same buffer,
+	// and lanes with a null input are fed silence (their output is discarded when null)
+	void process_block(const float* const* in, float* const* out, unsigned int frames);
+
+	~MoogFilterBank() { };
+
+private:
+	float sampleRate_;
+	unsigned int oversampling_;		// ladder steps per sample
+	float omegaScale_;				// 2 pi / ladder rate (normalised angular frequency per Hz)
+
+	// coefficients for a cutoff and resonance
+	void calculate_coefficients(float frequencyHz, float resonance, float& g, float& res);
+
+	// per-lane coefficients, loaded into vectors for each block
+	alignas(16) float g_[kLanes];			// cutoff coefficient
+	alignas(16) float res_[kLanes];			// resonance coefficient
+	alignas(16) float comp_[kLanes];		// compensation coefficient
+	alignas(16) float gStep_[kLanes];		// change in g_ per sample while ramping
+	alignas(16) float resStep_[kLanes];		// change in res_ per sample while ramping
+	float gTarget_[kLanes];					// end of the ramps
+	float resTarget_[kLanes];
+	unsigned int rampFrames_[kLanes];		// samples left to ramp
+	float frequency_[kLanes];				// parameters of the last set_params or ramp_params
+	float resonance_[kLanes];
+
+	// output mix of the section outputs for each lane's filter type
+	alignas(16) float mix_[5][kLanes];
+
+	// section outputs on the previous sample (including input after non-linearity)
+	alignas(16) float sectionOuts_[5][kLanes];
+
+	// half-band filters into and out of the oversampled ladder (stage 2 only for 4x)
+	HalfBandUpsampler<HalfBandSteep> upsampler1_;
+	HalfBandUpsampler<HalfBandShort> upsampler2_;
+	HalfBandDownsampler<HalfBandShort> downsampler2_;
+	HalfBandDownsampler<HalfBandSteep> downsampler1_;
+
+	// processing for one oversampling factor
+	template <unsigned int kFactor> void process_block_factor(const float* const* in, float* const* out, unsigned int frames);
+	void (MoogFilterBank::*processBlock_)(const float* const*, float* const*, unsigned int);
+};
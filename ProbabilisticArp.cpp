@@ -2,21 +2,60 @@
 
 #include "ProbabilisticArp.h"
 
+#include <array>
 #include <vector>
 #include <utility>
 #include <stdio.h>
 #include <stdint.h>
-#include <assert.h>
 #include <cmath>
 #include <stdexcept>
 
-
-ProbabilisticArp::ProbabilisticArp(unsigned int subBeatsPerBeat, unsigned int beatsPerBar, unsigned int barsPerPattern, 		// constructor
-								   unsigned int lowestNote, unsigned int octaves, int seed1, int seed2, float seedBalance, 
-								   unsigned int tempDist)		
+#include "Sampler.h"
+
+
+// The tables below are shared by every instance, and each is a single block with one row per
+// mode or distribution: entry i of row r is at r * (row length) + i. (The seed sequences are in a SeedBank.)
+typedef BasicProbabilisticArp<rng::Xorshift64Star> Arp;		// for the table sizes, which do not depend on the generator
+
+static const unsigned int kNumModes = 2;
+static const unsigned int kNumTempDists = 3;
+
+// earlier notes in each row are more 'harmonically expected'
+// First row Major key, second row minor key
+// all notes relative to the harmonic root (0)
+static constexpr std::array<int, kNumModes * Arp::kChromaOptions> kNotes {{
+	7, 0, 4, -1, 9, 2, 11, 5, 8, 1, 3, 10, 6,
+	7, 0, 3, -1, 9, 2, 10, 5, 8, 1, 6, 11, 4
+}};
+
+// initial low- and high- temp distributions
+static constexpr std::array<float, kNumTempDists * Arp::kChromaOptions> kLowTempDists {{
+	8, 8, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	12, 12, 12, 0, 8, 8, 2, 0, 0, 0, 0, 2, 0,
+	12, 12, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+}};
+static constexpr std::array<float, kNumTempDists * Arp::kChromaOptions> kHighTempDists {{
+	8, 7, 6, 0, 4, 3, 2, 1, 0, 0, 0, 0, 0,
+	10, 8, 10, 0, 8, 8, 4, 2, 2, 2, 1, 4, 1,
+	8, 8, 8, 2, 12, 12, 8, 7, 6, 5, 4, 3, 2
+}};
+
+
+template <class Rng>
+BasicProbabilisticArp<Rng>::BasicProbabilisticArp(unsigned int subBeatsPerBeat, unsigned int beatsPerBar, unsigned int barsPerPattern, 		// constructor
+												  unsigned int lowestNote, unsigned int octaves, int seed1, int seed2, float seedBalance, 
+												  unsigned int tempDist, int64_t randomSeed)		
 	: subBeatsPerBeat_(subBeatsPerBeat), beatsPerBar_(beatsPerBar), barsPerPattern_(barsPerPattern), 
-	  lowestNote_(lowestNote), octaves_(octaves)
+	  lowestNote_(lowestNote), octaves_(octaves), sequenceLength_(subBeatsPerBeat * beatsPerBar * barsPerPattern)
 {
+	// the buffers have fixed capacity
+	if (sequenceLength_ == 0 || sequenceLength_ > kMaxSequenceLength) {
+		throw std::invalid_argument("Invalid argument to 'ProbabilisticArp': metre");
+	}
+	if (octaves == 0 || octaves > kMaxOctaves) {
+		throw std::invalid_argument("Invalid argument to 'ProbabilisticArp': octaves");
+	}
+	
 	// flag for generation of new notes
 	isPlaying_ = false;
 	
@@ -37,26 +76,24 @@ ProbabilisticArp::ProbabilisticArp(unsigned int subBeatsPerBeat, unsigned int be
 	dynamicContourTemp_ = 0;
 	consistency_ = 0;
 	pitchTemp_ = 0;
+	updateConsistencyWeights();
+	updateMovementWeights();
 
 	// distribution for possible next note relative to key
-	distribution_ = std::vector<float>(lowTempDists_[0].size(), 0);
-	startDistribution_ = std::vector<float>(lowTempDists_[0].size(), 0);	
+	distribution_.fill(0);
+	startDistribution_.fill(0);
 	// set tempDistChoice_
 	setTempDistChoice(tempDist);
 	// distribution for next note among octave equivalents
-	noteOptions_ = std::vector<float>(octaves, 0);
+	noteOptions_.fill(0);
 	
 	// RNG
-	std::random_device rd;
-	rng_ = std::mt19937(rd());
-	// uniform distribution
-	uniform_ = std::uniform_real_distribution<float>(0.0, 1.0);
+	setRandomSeed(randomSeed);
 	
-	// distribution for seed picking
-	seedDist_ = std::uniform_int_distribution<int>(0, seedSequences_.size() - 1);
-	
-	// resize seed_
-	seed_.resize(subBeatsPerBeat * beatsPerBar * barsPerPattern);
+	// start from the first built-in seed sequence (setSeedBalance reads the seed numbers before setSeed sets them)
+	seedBank_ = SeedBank::builtIn();
+	seed1num_ = 0;
+	seed2num_ = 0;
 	// set seed balance
 	setSeedBalance(seedBalance);
 	// assign a seed sequence 
@@ -64,11 +101,12 @@ ProbabilisticArp::ProbabilisticArp(unsigned int subBeatsPerBeat, unsigned int be
 	// put the seed sequence in the prevSequence_ buffer
 	prevSequence_ = seed_;
 	// initialise the prevNote_
-	prevNote_ = prevSequence_.back();
+	prevNote_ = prevSequence_[sequenceLength_ - 1];
 }
 
 
-void ProbabilisticArp::beat() 
+template <class Rng>
+void BasicProbabilisticArp<Rng>::beat() 
 {
 	// update sequence pointer position [metrical position]
 	if (++pointer_ >= subBeatsPerBeat_ * beatsPerBar_ * barsPerPattern_) {
@@ -76,95 +114,171 @@ void ProbabilisticArp::beat()
 	}	
 }
 
-void ProbabilisticArp::play() {isPlaying_ = true; }
-void ProbabilisticArp::stop() {isPlaying_ = false; }
-bool ProbabilisticArp::isPlaying() {return isPlaying_; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::play() {isPlaying_ = true; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::stop() {isPlaying_ = false; }
+template <class Rng>
+bool BasicProbabilisticArp<Rng>::isPlaying() {return isPlaying_; }
 
-void ProbabilisticArp::setMetre(unsigned int subBeatsPerBeat, unsigned int beatsPerBar, unsigned int barsPerPattern)
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setMetre(unsigned int subBeatsPerBeat, unsigned int beatsPerBar, unsigned int barsPerPattern)
 {
 	subBeatsPerBeat_ = subBeatsPerBeat;
 	beatsPerBar_ = beatsPerBar;
 	barsPerPattern_ = barsPerPattern;
 }
 
-void ProbabilisticArp::keyChange(unsigned int key) {key_ = key; }
-void ProbabilisticArp::modeChange(unsigned int mode) {mode_ = mode;	}
-
-unsigned int ProbabilisticArp::getKey() const {return key_; }
-unsigned int ProbabilisticArp::getMode() const {return mode_; }
-
-void ProbabilisticArp::setSequencePosition(unsigned int position) {pointer_ = position; }
-unsigned int ProbabilisticArp::getSequencePosition() const {return pointer_; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::keyChange(unsigned int key) {key_ = key; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::modeChange(unsigned int mode) {mode_ = mode;	}
+
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getKey() const {return key_; }
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getMode() const {return mode_; }
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setSequencePosition(unsigned int position) {pointer_ = position; }
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getSequencePosition() const {return pointer_; }
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setIntervalTemp(float intervalTemp) {intervalTemp_ = intervalTemp; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setContourTemp(float contourTemp) {contourTemp_ = contourTemp; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setRhythmicTemp(float rhythmicTemp) {rhythmicTemp_ = rhythmicTemp; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setSparsity(float sparsity) {sparsity_ = sparsity; }
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setConsistency(float consistency) 
+{
+	if (consistency != consistency_) {
+		consistency_ = consistency;
+		updateConsistencyWeights();
+	}
+}
 
-void ProbabilisticArp::setIntervalTemp(float intervalTemp) {intervalTemp_ = intervalTemp; }
-void ProbabilisticArp::setContourTemp(float contourTemp) {contourTemp_ = contourTemp; }
-void ProbabilisticArp::setRhythmicTemp(float rhythmicTemp) {rhythmicTemp_ = rhythmicTemp; }
-void ProbabilisticArp::setSparsity(float sparsity) {sparsity_ = sparsity; }
-void ProbabilisticArp::setConsistency(float consistency) {consistency_ = consistency; }
-void ProbabilisticArp::setMovement(float movement) {movement_ = movement; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setMovement(float movement) 
+{
+	if (movement != movement_) {
+		movement_ = movement;
+		updateMovementWeights();
+	}
+}
 
-void ProbabilisticArp::setHarmonicTemp(float harmonicTemp) 
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setHarmonicTemp(float harmonicTemp) 
 {
 	harmonicTemp_ = harmonicTemp; 
 	
 	// re-interpolate for the starting distribution
-	for (unsigned int i = 0; i < startDistribution_.size(); i++) {
-		startDistribution_[i] = lowTempDists_[tempDistChoice_][i] * (1 - harmonicTemp) + highTempDists_[tempDistChoice_][i] * harmonicTemp;
+	const float* low = &kLowTempDists[tempDistChoice_ * kChromaOptions];
+	const float* high = &kHighTempDists[tempDistChoice_ * kChromaOptions];
+	for (unsigned int i = 0; i < kChromaOptions; i++) {
+		startDistribution_[i] = low[i] * (1 - harmonicTemp) + high[i] * harmonicTemp;
 	}	
 }
 
-void ProbabilisticArp::setDynamicTemp(float dynamicTemp) {dynamicTemp_ = dynamicTemp; }
-void ProbabilisticArp::setDynamicContourTemp(float dynamicContourTemp) {dynamicContourTemp_ = dynamicContourTemp; };
-void ProbabilisticArp::setPitchTemp(float pitchTemp) {pitchTemp_ = pitchTemp; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setDynamicTemp(float dynamicTemp) {dynamicTemp_ = dynamicTemp; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setDynamicContourTemp(float dynamicContourTemp) {dynamicContourTemp_ = dynamicContourTemp; };
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setPitchTemp(float pitchTemp) {pitchTemp_ = pitchTemp; }
 
-void ProbabilisticArp::changeAllTempsByProportion(float proportion)
+template <class Rng>
+void BasicProbabilisticArp<Rng>::changeAllTempsByProportion(float proportion)
 {
-	if (proportion >= 0) {
-		intervalTemp_ += proportion * (1 - intervalTemp_);
-		contourTemp_ += proportion * (1 - contourTemp_);
-		rhythmicTemp_ += proportion * (1 - rhythmicTemp_);
-		sparsity_ += proportion * (1 - sparsity_);
-		consistency_ += proportion * (1 - consistency_);
-		movement_ += proportion * (1 - movement_);
-		harmonicTemp_ += proportion * (1 - harmonicTemp_);
-		dynamicTemp_ += proportion * (1 - dynamicTemp_);
-		dynamicContourTemp_ += proportion * (1 - dynamicContourTemp_);
-		pitchTemp_ += proportion * (1 - pitchTemp_);
+	intervalTemp_ = changeTempByProportion(intervalTemp_, proportion);
+	contourTemp_ = changeTempByProportion(contourTemp_, proportion);
+	rhythmicTemp_ = changeTempByProportion(rhythmicTemp_, proportion);
+	sparsity_ = changeTempByProportion(sparsity_, proportion);
+	consistency_ = changeTempByProportion(consistency_, proportion);
+	movement_ = changeTempByProportion(movement_, proportion);
+	harmonicTemp_ = changeTempByProportion(harmonicTemp_, proportion);
+	dynamicTemp_ = changeTempByProportion(dynamicTemp_, proportion);
+	dynamicContourTemp_ = changeTempByProportion(dynamicContourTemp_, proportion);
+	pitchTemp_ = changeTempByProportion(pitchTemp_, proportion);
+	
+	// re-interpolate for the starting distribution, and the weightings for the new temperatures
+	setHarmonicTemp(harmonicTemp_);
+	updateConsistencyWeights();
+	updateMovementWeights();
+}
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::updateConsistencyWeights()
+{
+	// low consistency pulls generated note towards that in previous pattern
+	for (unsigned int d = 0; d < kChromaDistances; d++) {
+		consistencyWeights_[d] = powf((13.0 - d) / 9.0, 8.0 * (1 - consistency_));
 	}
-	else {
-		intervalTemp_ *= 1 + proportion;
-		contourTemp_ *= 1 + proportion;
-		rhythmicTemp_ *= 1 + proportion;
-		sparsity_ *= 1 + proportion;
-		consistency_ *= 1 + proportion;
-		movement_ *= 1 + proportion;
-		harmonicTemp_ *= 1 + proportion;
-		dynamicTemp_ *= 1 + proportion;
-		dynamicContourTemp_ *= 1 + proportion;
-		pitchTemp_ *= 1 + proportion;
+}
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::updateMovementWeights()
+{
+	// high movement pulls generated note towards that of previous note played
+	for (unsigned int d = 0; d < kChromaDistances; d++) {
+		movementWeights_[d] = powf((12.0 - d) / 3.5, movement_);
 	}
 }
 
-float ProbabilisticArp::getIntervalTemp() {return intervalTemp_; };
-float ProbabilisticArp::getContourTemp() {return contourTemp_; };
-float ProbabilisticArp::getRhythmicTemp() {return rhythmicTemp_; };
-float ProbabilisticArp::getSparsity() {return sparsity_; };
-float ProbabilisticArp::getConsistency() {return consistency_; };
-float ProbabilisticArp::getMovement() {return movement_; };
-float ProbabilisticArp::getHarmonicTemp() {return harmonicTemp_; };
-float ProbabilisticArp::getDynamicTemp() {return dynamicTemp_; };
-float ProbabilisticArp::getDynamicContourTemp() {return dynamicContourTemp_; };
-float ProbabilisticArp::getPitchTemp() {return pitchTemp_; };
-
-float ProbabilisticArp::getOverallTemp() 
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getIntervalTemp() {return intervalTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getContourTemp() {return contourTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getRhythmicTemp() {return rhythmicTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getSparsity() {return sparsity_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getConsistency() {return consistency_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getMovement() {return movement_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getHarmonicTemp() {return harmonicTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getDynamicTemp() {return dynamicTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getDynamicContourTemp() {return dynamicContourTemp_; };
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getPitchTemp() {return pitchTemp_; };
+
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getOverallTemp() 
 {
-	float totalTemp = intervalTemp_ + contourTemp_ + rhythmicTemp_ + sparsity_ + consistency_ + 
-					  movement_ + harmonicTemp_ + dynamicTemp_ + dynamicContourTemp_ + pitchTemp_;	
+	const float temps[] = {intervalTemp_, contourTemp_, rhythmicTemp_, sparsity_, consistency_, 
+						   movement_, harmonicTemp_, dynamicTemp_, dynamicContourTemp_, pitchTemp_};
+	return overallTemp(temps);
+}
+
+template <class Rng>
+float BasicProbabilisticArp<Rng>::changeTempByProportion(float temp, float proportion)
+{
+	// positive proportions move towards 1, negative ones towards 0
+	if (proportion >= 0) {
+		return temp + proportion * (1 - temp);
+	}
+	return temp * (1 + proportion);
+}
+
+template <class Rng>
+float BasicProbabilisticArp<Rng>::overallTemp(const float* temps)
+{
+	float totalTemp = temps[0] + temps[1] + temps[2] + temps[3] + temps[4] + 
+					  temps[5] + temps[6] + temps[7] + temps[8] + temps[9];	
 	return totalTemp / 9.0;
 }
 
 
-std::pair<int, float> ProbabilisticArp::generate()
+template <class Rng>
+std::pair<int, float> BasicProbabilisticArp<Rng>::generate()
 {
 	if (isPlaying_) {
 		// initialise note and output
@@ -181,6 +295,7 @@ std::pair<int, float> ProbabilisticArp::generate()
 		// bias towards no note if there was no note previously with low rhythm temperature
 		// deal with initialisation of seed sequence
 		int prevSeqNote = std::get<0>(prevSequence_[pointer_]);		// note at this metrical position in last pattern played
+		const int* notes = &kNotes[mode_ * kChromaOptions];			// chroma options in the current mode
 		
 		// rt_printf("Pointer: %d, prevSeqNote: %d\n", pointer_, prevSeqNote);
 		
@@ -188,10 +303,10 @@ std::pair<int, float> ProbabilisticArp::generate()
 		if (prevSeqNote != -1) {			// check it is not a non-note
 			// convert to chroma class
 			int prevSeqChroma = prevSeqNote % 12;						
-			for (unsigned int i = 0; i < distribution_.size(); i++) {
+			for (unsigned int i = 0; i < kChromaOptions; i++) {
 				// weight options by proximity to previous sequence
-				if (notes_[mode_][i] != -1) {			// check it is not a non-note (this will be dealt with separately)
-					distribution_[i] *= powf((13.0 - (float)std::abs(notes_[mode_][i] - prevSeqChroma)) / 9.0, 8.0 * (1 - consistency_));	// low consistency slider position pulls generated note towards that in previous pattern
+				if (notes[i] != -1) {			// check it is not a non-note (this will be dealt with separately)
+					distribution_[i] *= consistencyWeights_[std::abs(notes[i] - prevSeqChroma)];	// low consistency slider position pulls generated note towards that in previous pattern
 				}
 				else {
 					// update probability of no new note based on sparsity
@@ -204,8 +319,8 @@ std::pair<int, float> ProbabilisticArp::generate()
 		// if there was no note in the previous sequence
 		else {
 			// only update non-note weighting
-			for (unsigned int i = 0; i < distribution_.size(); i++)	{
-				if (notes_[mode_][i] == -1) {
+			for (unsigned int i = 0; i < kChromaOptions; i++)	{
+				if (notes[i] == -1) {
 					// also update probability of no new note based on sparsity
 					distribution_[i] += sparsity_ * 24.0;
 				}
@@ -221,10 +336,10 @@ std::pair<int, float> ProbabilisticArp::generate()
 		
 		// update probabilities based on previous note (movement)
 		int prevNote = -1;
-		unsigned int prevPosition = (prevSequence_.size() + pointer_ - 1) % prevSequence_.size();
+		unsigned int prevPosition = (sequenceLength_ + pointer_ - 1) % sequenceLength_;
 		while (prevNote == -1) {
 			// decrement pointer
-			prevPosition = (prevSequence_.size() + prevPosition - 1) % prevSequence_.size();
+			prevPosition = (sequenceLength_ + prevPosition - 1) % sequenceLength_;
 			prevNote = std::get<0>(prevSequence_[prevPosition]);
 			// protect against the improbable degeneration to all non-notes 
 			if (prevPosition == pointer_) {
@@ -234,9 +349,9 @@ std::pair<int, float> ProbabilisticArp::generate()
 		// convert to a chroma class value
 		int prevNoteChroma = prevNote % 12;
 		// update distributuion weights according to proximity
-		for (unsigned int i = 0; i < distribution_.size(); i++) {
-			if (notes_[mode_][i] != -1) {			// check it is not a non-note 
-				distribution_[i] *= powf((12.0 - std::abs(notes_[mode_][i] - prevNoteChroma)) / 3.5, 1.0 * (movement_));	// high movement pulls generated note towards that of previous note played
+		for (unsigned int i = 0; i < kChromaOptions; i++) {
+			if (notes[i] != -1) {			// check it is not a non-note 
+				distribution_[i] *= movementWeights_[std::abs(notes[i] - prevNoteChroma)];	// high movement pulls generated note towards that of previous note played
 			}
 		}
 
@@ -244,12 +359,12 @@ std::pair<int, float> ProbabilisticArp::generate()
 		// 		  distribution_[4], distribution_[5], distribution_[6], distribution_[7], distribution_[8], distribution_[9], distribution_[10], distribution_[11], distribution_[12]);		
 
 		// sample from distribution
-		unsigned int position = sampleFrom(distribution_);
+		unsigned int position = sampleFrom(distribution_.data(), kChromaOptions);
 		
 		// rt_printf("Chosen position: %d\n", position);
 		
 		// get note number
-		note = notes_[mode_][position];
+		note = notes[position];
 		
 	
 		// if note is '-1', this represents no note, so just return it
@@ -264,11 +379,11 @@ std::pair<int, float> ProbabilisticArp::generate()
 				prevContour = Contour::noNote;
 			}
 			else {
-				prevPosition = (seed_.size() + prevPosition - 1) % prevSequence_.size();
+				prevPosition = (sequenceLength_ + prevPosition - 1) % sequenceLength_;
 				int prevSeedNote = std::get<0>(seed_[prevPosition]);
 				while (prevSeedNote == -1) {
 					// decrement pointer
-					prevPosition = (seed_.size() + prevPosition - 1) % seed_.size();
+					prevPosition = (sequenceLength_ + prevPosition - 1) % sequenceLength_;
 					prevSeedNote = std::get<0>(seed_[prevPosition]);
 					// protect against the improbable degeneration to all non-notes 
 					if (prevPosition == pointer_) {
@@ -304,7 +419,7 @@ std::pair<int, float> ProbabilisticArp::generate()
 			}
 
 			// loop through octaves
-			for (unsigned int i = 0; i < noteOptions_.size(); i++) {
+			for (unsigned int i = 0; i < octaves_; i++) {
 				// set note to i octaves above lowest allowed
 				tempNote = lowestNote_ + (note + 12 * i);
 				difference = std::abs(tempNote - prevSeqNote);
@@ -339,7 +454,7 @@ std::pair<int, float> ProbabilisticArp::generate()
 			// rt_printf("after contour: {%f, %f, %f, %f}\n", noteOptions_[0], noteOptions_[1], noteOptions_[2], noteOptions_[3]);			
 			
 			// adjust weights of octave positions which are not closest to current chosen note
-			for (unsigned int i = 0; i < noteOptions_.size(); i++) {
+			for (unsigned int i = 0; i < octaves_; i++) {
 				if (i != closestPosInt) {
 					noteOptions_[i] *= (intervalTemp_ * 1.9) + 0.1;		// multiply by 2 to allow non-closest to be most likely option for high temperatures
 				}
@@ -348,14 +463,14 @@ std::pair<int, float> ProbabilisticArp::generate()
 			// rt_printf("after interval: {%f, %f, %f, %f}\n", noteOptions_[0], noteOptions_[1], noteOptions_[2], noteOptions_[3]);				
 
 			// adjust weights by interval relative to the seed sequence
-			for (unsigned int i = 0; i < noteOptions_.size(); i++) {
+			for (unsigned int i = 0; i < octaves_; i++) {
 				if (i != closestPosPitch) {
 					noteOptions_[i] *= pitchTemp_ + 0.001;
 				}
 			}
 
 			// sample from distribution
-			position = sampleFrom(noteOptions_);
+			position = sampleFrom(noteOptions_.data(), octaves_);
 			
 			// get note
 			outputNote = lowestNote_ + note + position * 12;
@@ -370,7 +485,7 @@ std::pair<int, float> ProbabilisticArp::generate()
 		
 		// vary amplitude according to dynamicTemp
 		if (dynamicTemp_ > 0) {
-			outputAmp *= (1 + (0.5 - uniform_(rng_)) * dynamicTemp_ / 4.0);
+			outputAmp *= (1 + (0.5 - rng::uniform(rng_)) * dynamicTemp_ / 4.0);
 		}
 
 		// rt_printf("after dynamic: %f\n", outputAmp);	
@@ -391,70 +506,40 @@ std::pair<int, float> ProbabilisticArp::generate()
 }
 
 
-unsigned int ProbabilisticArp::sampleFrom(std::vector<float>& distribution)
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::sampleFrom(const float* distribution, unsigned int size)
 {
-	// normalise
-	float sum = 0;
-	for (unsigned int i = 0; i < distribution.size(); i++) {
-		sum += distribution[i];
-	}
-	// make cumulative along interval [0, 1]
-	for (unsigned int i = 0; i < distribution.size(); i++) {
-		distribution[i] /= sum;
-		if (i > 0) {
-			distribution[i] += distribution[i - 1];
-		}
-	}
-	
-	assert (distribution.back() == 1.0);
-	
-	// generate new random number
-	float randNum = uniform_(rng_);
-	
-	// rt_printf("Random number: %f\n", randNum);
-	
-	assert (randNum <= 1.0);
-	
-	int position = -1;
-	
-	// get position
-	for (unsigned int i = 0; i < distribution.size(); i++) {
-		if (distribution[i] >= randNum) {
-			// select the note number from the list according to randNum
-			position = i;
-			break;
-		}
-	}
-	
-	assert (position >= 0);
-	
-	return position;
+	// the distributions are rebuilt for every note, so there is no table to reuse
+	return sampler::sample(distribution, size, rng::uniform(rng_));
 }
 
 
 // get the number of available seeds
-unsigned int ProbabilisticArp::numSeeds() {return seedSequences_.size(); }
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::numSeeds() {return seedBank_->size(); }
 
-void ProbabilisticArp::setSeed(int seed1, int seed2)
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setSeed(int seed1, int seed2)
 {
 	// check seed1 and seed2
-	if (seed1 < -1 || seed1 >= seedSequences_.size()) {
+	int numSeeds = seedBank_->size();
+	if (seed1 < -1 || seed1 >= numSeeds) {
 		seed1 = -1;
 	}
-	if (seed2 < -1 || seed2 >= seedSequences_.size()) {
+	if (seed2 < -1 || seed2 >= numSeeds) {
 		seed2 = -1;
 	}
 	
 	if (seed1 != seed1num_ || seed2 != seed2num_) {			// only proceed if necessary
 		if (seed1 == -1) {
 			// randomly pick a seed number
-			seed1 = seedDist_(rng_);
+			seed1 = rng::below(rng_, numSeeds);
 		}
 		if (seed2 == -1) {
 			seed2 = seed1;
-			while (seed2 == seed1) {
+			while (seed2 == seed1 && numSeeds > 1) {
 				// randomly pick a seed number
-				seed2 = seedDist_(rng_);
+				seed2 = rng::below(rng_, numSeeds);
 			}
 		}
 	}
@@ -467,7 +552,8 @@ void ProbabilisticArp::setSeed(int seed1, int seed2)
 	setSeedBalance(seedBalance_);
 }
 
-void ProbabilisticArp::setSeedBalance(float balance) 
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setSeedBalance(float balance) 
 {
 	// check balance
 	if (balance < 0 || balance > 1) {
@@ -479,25 +565,48 @@ void ProbabilisticArp::setSeedBalance(float balance)
 	seedBalance_ = balance;
 
 	// interpolate between the two seed sequences
-	for (unsigned int i = 0; i < seed_.size(); i++) {
-		float noteinterp = round((1 - balance) * std::get<0>(seedSequences_[seed1num_][i]) + 
-								  balance * std::get<0>(seedSequences_[seed2num_][i]));
+	const SeedBank::Step* seed1 = seedBank_->sequence(seed1num_);
+	const SeedBank::Step* seed2 = seedBank_->sequence(seed2num_);
+	for (unsigned int i = 0; i < sequenceLength_; i++) {
+		float noteinterp = round((1 - balance) * SeedBank::note(seed1[i]) + 
+								  balance * SeedBank::note(seed2[i]));
 		int note = noteinterp;
-		float amplitude = (1 - balance) * std::get<1>(seedSequences_[seed1num_][i]) + 
-						  balance * std::get<1>(seedSequences_[seed2num_][i]);
+		float amplitude = (1 - balance) * SeedBank::amplitude(seed1[i]) + 
+						  balance * SeedBank::amplitude(seed2[i]);
 		seed_[i] = {note, amplitude};
 	}
 }
 
-float ProbabilisticArp::getSeedBalance() {return seedBalance_; }
+template <class Rng>
+float BasicProbabilisticArp<Rng>::getSeedBalance() {return seedBalance_; }
+
+template <class Rng>
+std::vector<int> BasicProbabilisticArp<Rng>::getSeeds() {return std::vector<int> {seed1num_, seed2num_}; }
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setSeedBank(std::shared_ptr<const SeedBank> bank)
+{
+	if (!bank || bank->length() < sequenceLength_) {
+		throw std::invalid_argument("Invalid argument to 'setSeedBank': bank");
+	}
+	seedBank_ = bank;
+	
+	// keep the seed numbers where the new bank has them, otherwise pick again
+	int seed1 = seed1num_ < (int)bank->size() ? seed1num_ : -1;
+	int seed2 = seed2num_ < (int)bank->size() ? seed2num_ : -1;
+	setSeed(seed1, seed2);
+}
 
-std::vector<int> ProbabilisticArp::getSeeds() {return std::vector<int> {seed1num_, seed2num_}; }
+template <class Rng>
+std::shared_ptr<const SeedBank> BasicProbabilisticArp<Rng>::getSeedBank() const {return seedBank_; }
 
-void ProbabilisticArp::resetToSeed() {prevSequence_ = seed_; }
+template <class Rng>
+void BasicProbabilisticArp<Rng>::resetToSeed() {prevSequence_ = seed_; }
 
-void ProbabilisticArp::setTempDistChoice(unsigned int choice)
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setTempDistChoice(unsigned int choice)
 {
-	if (choice >= lowTempDists_.size()) {
+	if (choice >= kNumTempDists) {
 		throw std::invalid_argument("Invalid argument to 'setTempDistChoice': choice");
 	}
 	// set tempDistChoice_
@@ -507,16 +616,44 @@ void ProbabilisticArp::setTempDistChoice(unsigned int choice)
 	setHarmonicTemp(harmonicTemp_);
 }
 
-unsigned int ProbabilisticArp::getNumTempDists() {return lowTempDists_.size(); }
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getTempDistChoice() const {return tempDistChoice_; }
+
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getNumTempDists() {return kNumTempDists; }
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::setRandomSeed(int64_t seed)
+{
+	randomSeed_ = seed < 0 ? rng::randomSeed() : seed;
+	rng_.seed(randomSeed_);
+}
 
+template <class Rng>
+uint64_t BasicProbabilisticArp<Rng>::getRandomSeed() const {return randomSeed_; }
+
+template <class Rng>
+unsigned int BasicProbabilisticArp<Rng>::getSequenceLength() const {return sequenceLength_; }
+
+template <class Rng>
+typename BasicProbabilisticArp<Rng>::StepState BasicProbabilisticArp<Rng>::saveStepState() const
+{
+	// the entry the next beat() and generate() will overwrite
+	unsigned int next = (pointer_ + 1) % sequenceLength_;
+	return StepState {pointer_, prevSequence_[next], prevNote_, rng_};
+}
+
+template <class Rng>
+void BasicProbabilisticArp<Rng>::restoreStepState(const StepState& state)
+{
+	pointer_ = state.pointer;
+	prevSequence_[(pointer_ + 1) % sequenceLength_] = state.overwritten;
+	prevNote_ = state.prevNote;
+	rng_ = state.rng;
+}
 
-// optional alternative random number generator
-// uint64_t ProbabilisticArp::xorshift64(struct xorshift64_state *state)
-// 	{
-// 		uint64_t x = state->a;
-// 		x ^= x << 13;
-// 		x ^= x >> 7;
-// 		x ^= x << 17;
-// 		return state->a = x;
-// 	}
 
+// the generators the arpeggiator can be built with
+template class BasicProbabilisticArp<rng::Xorshift64Star>;
+template class BasicProbabilisticArp<rng::Pcg32>;
+template class BasicProbabilisticArp<rng::Mt19937>;
@@ -2,14 +2,26 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
 #include <vector>
 #include <utility>
-#include <random>
 #include <stdint.h>
 
-class ProbabilisticArp {
+#include "Random.h"
+#include "SeedBank.h"
+
+// Rng is one of the generators in Random.h (ProbabilisticArp below uses Xorshift64Star)
+template <class Rng>
+class BasicProbabilisticArp {
 public:
-	ProbabilisticArp(unsigned int subBeatsPerBeat = 4,			// constructor
+	// the harmony tables are constant and shared by every instance (see ProbabilisticArp.cpp), as is the seed
+	// bank, and the working buffers have fixed capacity, so constructing one allocates nothing
+	static const unsigned int kMaxSequenceLength = 64;		// longest pattern (the length of the seed sequences)
+	static const unsigned int kMaxOctaves = 10;				// widest range of output notes
+	static const unsigned int kChromaOptions = 13;			// 12 chroma classes and no note
+	
+	BasicProbabilisticArp(unsigned int subBeatsPerBeat = 4,		// constructor
 					 unsigned int beatsPerBar = 4, 
 					 unsigned int barsPerPattern = 4, 
 					 unsigned int lowestNote = 36, 
@@ -17,7 +29,8 @@ public:
 					 int seed1 = -1,
 					 int seed2 = -1, 
 					 float seedBalance = 0, 
-					 unsigned int tempDist = 0);
+					 unsigned int tempDist = 0, 
+					 int64_t randomSeed = -1);
 	
 	void setMetre(unsigned int subBeatsPerBeat, unsigned int beatsPerBar, unsigned int barsPerPattern);		// define the metre
 	
@@ -60,6 +73,10 @@ public:
 	// get the overall proportion of the sum of the temperature values compared to the total possible
 	float getOverallTemp();
 	
+	// the arithmetic behind the two above, for a copy of the settings kept elsewhere (see ArpLookahead.h)
+	static float changeTempByProportion(float temp, float proportion);
+	static float overallTemp(const float* temps);				// interval, contour, rhythmic, sparsity, consistency, movement, harmonic, dynamic, dynamic contour, pitch
+	
 	void beat();			// move one the metrical position by 1
 	void play();			// set isPlaying flag to true
 	void stop();			// set isPlaying flag to false
@@ -72,12 +89,35 @@ public:
 	void setSeedBalance(float balance);							// change the interpolation weighting between the 2 seeds
 	float getSeedBalance();										// return the interpolation ratio between the 2 seed sequences
 	unsigned int numSeeds();									// return the number of available seed seqeunces
+	// choose the seed sequences from a bank (the built-in one to start with) - not for the audio thread
+	// (the bank's sequences must be at least as long as the pattern)
+	void setSeedBank(std::shared_ptr<const SeedBank> bank);
+	std::shared_ptr<const SeedBank> getSeedBank() const;
 	void resetToSeed();											// resets previous sequence to match seed
 	
+	// restart the random number generator - a run is repeated exactly by the same seed, settings and calls
+	// (a seed of -1 picks one at random)
+	void setRandomSeed(int64_t seed = -1);
+	uint64_t getRandomSeed() const;								// return the seed the generator was last started from
+	
 	void setTempDistChoice(unsigned int choice = 0);			// set the choice for temperature distribution (distributions for note chroma)
+	unsigned int getTempDistChoice() const;
 	unsigned int getNumTempDists();								// return the number of choices for temperature distributions
 	
-	~ProbabilisticArp() = default;								// destructor
+	// for generating steps ahead of time (see ArpLookahead.h)
+	unsigned int getSequenceLength() const;						// number of steps in the pattern
+	
+	// everything one beat() and generate() change, so that steps generated ahead can be undone
+	struct StepState {
+		int pointer;
+		std::pair<int, float> overwritten;						// previous sequence entry at the next position
+		std::pair<int, float> prevNote;
+		Rng rng;
+	};
+	StepState saveStepState() const;							// call before beat() and generate()
+	void restoreStepState(const StepState& state);				// undo them
+	
+	~BasicProbabilisticArp() = default;							// destructor
 	
 private:
 	bool isPlaying_;
@@ -95,31 +135,19 @@ private:
 	unsigned int mode_;				// 0 major, 1 minor
 	// unsigned int prevMode_;
 	
-	std::vector<std::pair<int, float>> prevSequence_;		// circular buffer for sequence
+	std::array<std::pair<int, float>, kMaxSequenceLength> prevSequence_;		// circular buffer for sequence (the first sequenceLength_ entries)
 	std::pair<int, float> prevNote_;						// holds previous note
 	
 	unsigned int lowestNote_;								// MIDI pitch of lowest permitted note output - should be multiple of 12 [in the C chroma class]
 	unsigned int octaves_;									// number of octaves above lowest note in range of possible output notes
+	unsigned int sequenceLength_;							// steps in the pattern (subBeatsPerBeat * beatsPerBar * barsPerPattern at construction)
 	
 	// random number generator
-	// https://en.wikipedia.org/wiki/Xorshift
-	// random number
-	// struct xorshift64_state {
-	//   uint64_t a;
-	// };
-	// // generate a new number
-	// uint64_t xorshift64(struct xorshift64_state *state);
-	
-	// random number
-	std::mt19937 rng_;
-	
-	// convert to float in the uniform distributions
-	std::uniform_real_distribution<float> uniform_;
-	// distribution for picking seeds a random
-	std::uniform_int_distribution<int> seedDist_;
+	Rng rng_;
+	uint64_t randomSeed_;									// seed it was last started from
 	
 	// function to sample from a non-normalised distribution using the uniform distribution
-	unsigned int sampleFrom(std::vector<float>& distribution);
+	unsigned int sampleFrom(const float* distribution, unsigned int size);
 	
 	// determine the degree of randomness and unexpectedness in the generative process
 	float pitchTemp_;				// the degree to which the pitch can vary from the seed pitch at that sequence position
@@ -133,28 +161,22 @@ private:
 	float dynamicTemp_;				// how much the dynamics can vary by for each generated note
 	float dynamicContourTemp_;		// how far the dynamics can stray from the seed seqeunce
 	
+	// chroma weightings for consistency and movement, indexed by the distance in semitones (0 to 11) between
+	// the proposed chroma and the one it is compared with; rebuilt whenever the temperature behind them changes
+	static const unsigned int kChromaDistances = 12;
+	std::array<float, kChromaDistances> consistencyWeights_;
+	std::array<float, kChromaDistances> movementWeights_;
+	void updateConsistencyWeights();
+	void updateMovementWeights();
+	
 	
-	// earlier notes in the vector are more 'harmonically expected'
-	// First row Major key, second row minor key
-	// all notes relative to the harmonic root (0)
-	std::vector<std::vector<int>> notes_ {{7, 0, 4, -1, 9, 2, 11, 5, 8, 1, 3, 10, 6}, 
-										  {7, 0, 3, -1, 9, 2, 10, 5, 8, 1, 6, 11, 4}};
-	
-	// initial low- and high- temp distributions
-	std::vector<std::vector<int>> lowTempDists_ {{8, 8, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 
-												 {12, 12, 12, 0, 8, 8, 2, 0, 0, 0, 0, 2, 0}, 
-												 {12, 12, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
-	std::vector<std::vector<int>> highTempDists_ {{8, 7, 6, 0, 4, 3, 2, 1, 0, 0, 0, 0, 0}, 
-												  {10, 8, 10, 0, 8, 8, 4, 2, 2, 2, 1, 4, 1}, 
-												  {8, 8, 8, 2, 12, 12, 8, 7, 6, 5, 4, 3, 2}};
-												  
 	int tempDistChoice_;
-	std::vector<float> startDistribution_;			// holds the start point for calculating the distribution for note chroma choice (an interpolation between the 'low' and 'high' options)
-	std::vector<float> distribution_;				// holds the distribution weightings for note chroma choice
+	std::array<float, kChromaOptions> startDistribution_;	// holds the start point for calculating the distribution for note chroma choice (an interpolation between the 'low' and 'high' options)
+	std::array<float, kChromaOptions> distribution_;		// holds the distribution weightings for note chroma choice
 	
 	// std::vector<float> distWeightings_;
 	
-	std::vector<float> noteOptions_;				// holds distribution weightings for octave options
+	std::array<float, kMaxOctaves> noteOptions_;			// holds distribution weightings for octave options (the first octaves_ are used)
 	
 	// enum constants for tracking contour relative to seed sequence
 	enum class Contour {
@@ -165,26 +187,10 @@ private:
 	};
 	
 	float seedBalance_;								// interpolation ratio between two chosen seeds
-	int seed1num_;									// index (in seedSequences_) of first seed
-	int seed2num_;									// index (in seedSequences_) of second seed
-	std::vector<std::pair<int, float>> seed_;		// holds the current interpolation between the two chosen seed sequences
-	
-	std::vector<std::vector<std::pair<int, float>>> seedSequences_ {{{48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, 
-																	 {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, 
-																	 {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, 
-																	 {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}, {48, 1.0}}, 
-																	{{48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}, {55, 1.0}, {48, 0.9}, {51, 0.9}, {55, 0.9}, {48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, 
-																	 {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}, {55, 1.0}, {48, 0.9}, {51, 0.9}, {55, 0.9}, {48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}, 
-																	 {48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}, {55, 1.0}, {48, 0.9}, {51, 0.9}, {55, 0.9}, {48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, 
-																	 {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}, {55, 1.0}, {48, 0.9}, {51, 0.9}, {55, 0.9}, {48, 1.0}, {51, 0.9}, {55, 0.9}, {48, 0.9}, {51, 1.0}, {55, 0.9}, {48, 0.9}, {51, 0.9}}, 
-																	{{48, 1.0}, {51, 0.9}, {55, 0.9}, {60, 0.9}, {62, 1.0}, {63, 0.9}, {67, 0.9}, {72, 0.9}, {74, 1.0}, {75, 0.9}, {79, 0.9}, {84, 0.9}, {86, 1.0}, {87, 0.9}, {93, 0.9}, {91, 0.9}, 
-																	 {48, 1.0}, {51, 0.9}, {55, 0.9}, {60, 0.9}, {62, 1.0}, {63, 0.9}, {67, 0.9}, {72, 0.9}, {74, 1.0}, {75, 0.9}, {79, 0.9}, {84, 0.9}, {86, 1.0}, {87, 0.9}, {93, 0.9}, {91, 0.9}, 
-																	 {48, 1.0}, {51, 0.9}, {55, 0.9}, {60, 0.9}, {62, 1.0}, {63, 0.9}, {67, 0.9}, {72, 0.9}, {74, 1.0}, {75, 0.9}, {79, 0.9}, {84, 0.9}, {86, 1.0}, {87, 0.9}, {93, 0.9}, {91, 0.9}, 
-																	 {48, 1.0}, {51, 0.9}, {55, 0.9}, {60, 0.9}, {62, 1.0}, {63, 0.9}, {67, 0.9}, {72, 0.9}, {74, 1.0}, {75, 0.9}, {79, 0.9}, {84, 0.9}, {86, 1.0}, {87, 0.9}, {93, 0.9}, {91, 0.9}},
-																	{{60, 1.0}, {72, 1.0}, {-1, 0.4}, {60, 1.0}, {72, 1.0}, {-1, 0.4}, {60, 1.0}, {72, 1.2}, {-1, 0.4}, {60, 1.0}, {72, 1.0}, {-1, 0.4}, {60, 1.0}, {72, 1.0}, {-1, 0.4}, {-1, 0.4}, 
-																	 {60, 1.0}, {63, 1.0}, {-1, 0.4}, {60, 1.0}, {63, 1.0}, {-1, 0.4}, {60, 1.0}, {63, 1.2}, {-1, 0.4}, {60, 1.0}, {63, 1.0}, {-1, 0.4}, {60, 1.0}, {63, 1.0}, {-1, 0.4}, {-1, 0.4}, 
-																	 {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.2}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {-1, 0.4}, 
-																	 {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.2}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {60, 1.0}, {67, 1.0}, {-1, 0.4}, {-1, 0.4}}, 
-	};
+	std::shared_ptr<const SeedBank> seedBank_;		// the seed sequences to choose from
+	int seed1num_;									// index (in seedBank_) of first seed
+	int seed2num_;									// index (in seedBank_) of second seed
+	std::array<std::pair<int, float>, kMaxSequenceLength> seed_;	// holds the current interpolation between the two chosen seed sequences
 };
 
+typedef BasicProbabilisticArp<rng::Xorshift64Star> ProbabilisticArp;
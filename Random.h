@@ -0,0 +1,125 @@
+/***** Random.h *****/
+
+/*
+Random number generators for the generative code, interchangeable as a template
+parameter. Each one has
+	seed(uint64_t)		restart the sequence (the same seed always gives the same numbers)
+	next()				32 random bits
+and rng::uniform() and rng::below() turn those bits into floats and bounded integers
+the same way for all of them, so a run depends only on the generator and its seed.
+
+	Xorshift64Star		8 bytes of state, a shift-xor and a multiply per number
+						https://en.wikipedia.org/wiki/Xorshift#xorshift*
+	Pcg32				8 bytes of state (a fixed stream), better statistics for about the same cost
+						https://www.pcg-random.org
+	Mt19937				the standard library Mersenne Twister, 2.5 KB of state
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <random>
+
+namespace rng {
+
+// spread the bits of a seed, so that nearby seeds start far apart
+// https://prng.di.unimi.it/splitmix64.c
+inline uint64_t splitMix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+class Xorshift64Star {
+public:
+	explicit Xorshift64Star(uint64_t seedValue = 1) {seed(seedValue); }
+
+	void seed(uint64_t seedValue)
+	{
+		// the state must never be zero
+		state_ = splitMix64(seedValue);
+		if (state_ == 0) {
+			state_ = 1;
+		}
+	}
+
+	uint32_t next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return (state_ * 0x2545f4914f6cdd1dull) >> 32;		// the high bits are the good ones
+	}
+
+private:
+	uint64_t state_;
+};
+
+// PCG-XSH-RR with a 64 bit state
+class Pcg32 {
+public:
+	explicit Pcg32(uint64_t seedValue = 1) {seed(seedValue); }
+
+	void seed(uint64_t seedValue)
+	{
+		state_ = 0;
+		next();
+		state_ += seedValue;
+		next();
+	}
+
+	uint32_t next()
+	{
+		uint64_t previous = state_;
+		state_ = previous * 6364136223846793005ull + kIncrement;
+		uint32_t xorShifted = ((previous >> 18) ^ previous) >> 27;
+		uint32_t rotation = previous >> 59;
+		return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31));
+	}
+
+private:
+	static const uint64_t kIncrement = 1442695040888963407ull;		// odd: selects the stream
+	uint64_t state_;
+};
+
+class Mt19937 {
+public:
+	explicit Mt19937(uint64_t seedValue = 1) {seed(seedValue); }
+
+	void seed(uint64_t seedValue)
+	{
+		std::seed_seq sequence {(uint32_t)seedValue, (uint32_t)(seedValue >> 32)};
+		engine_.seed(sequence);
+	}
+
+	uint32_t next() {return engine_(); }
+
+private:
+	std::mt19937 engine_;
+};
+
+// uniform float in [0, 1): the top 24 bits fill the mantissa exactly
+template <class Generator>
+inline float uniform(Generator& generator)
+{
+	return (generator.next() >> 8) * (1.0f / (1 << 24));
+}
+
+// uniform integer in [0, n), by a multiply and shift rather than a divide
+// (biased by at most n / 2^32, which is nothing for the small ranges used here)
+template <class Generator>
+inline uint32_t below(Generator& generator, uint32_t n)
+{
+	return ((uint64_t)generator.next() * n) >> 32;
+}
+
+// a seed from the operating system, for runs that need not be repeatable
+inline uint64_t randomSeed()
+{
+	std::random_device device;
+	return ((uint64_t)device() << 32) | device();
+}
+
+} // namespace rng
@@ -0,0 +1,151 @@
+/***** Sampler.cpp *****/
+
+#include "Sampler.h"
+#include "Simd.h"
+
+#include <stdexcept>
+
+
+unsigned int sampler::sample(const float* weights, unsigned int size, float uniform)
+{
+	// total weight
+	simd::float4 sums = simd::float4::set1(0);
+	unsigned int i = 0;
+	for (; i + simd::kLanes <= size; i += simd::kLanes) {
+		sums = sums + simd::float4::load(&weights[i]);
+	}
+	float total = simd::sum(sums);
+	for (; i < size; i++) {
+		total += weights[i];
+	}
+
+	// the bins whose running sum is at or below the target all come before the chosen one
+	float target = uniform * total;
+	simd::float4 targets = simd::float4::set1(target);
+	simd::float4 carry = simd::float4::set1(0);
+	simd::int4 counts = simd::int4::set1(0);
+	for (i = 0; i + simd::kLanes <= size; i += simd::kLanes) {
+		simd::float4 running = carry + simd::prefixSum(simd::float4::load(&weights[i]));
+		counts = counts - simd::lessEqual(running, targets);		// true lanes are -1
+		carry = simd::broadcastLast(running);
+	}
+	unsigned int position = simd::sum(counts);
+
+	// the remaining bins one at a time
+	float lanes[simd::kLanes];
+	carry.store(lanes);
+	float running = lanes[0];
+	for (; i < size; i++) {
+		running += weights[i];
+		if (running <= target) {
+			position++;
+		}
+	}
+
+	// rounding can put the target at the total: take the last bin with any weight
+	if (position >= size) {
+		position = size - 1;
+		while (position > 0 && weights[position] <= 0) {
+			position--;
+		}
+	}
+
+	return position;
+}
+
+
+AliasTable::AliasTable() {}
+
+AliasTable::AliasTable(const float* weights, unsigned int size)
+{
+	setup(weights, size);
+}
+
+void AliasTable::setup(const float* weights, unsigned int size)
+{
+	double total = 0;
+	for (unsigned int i = 0; i < size; i++) {
+		if (weights[i] < 0) {
+			throw std::invalid_argument("Invalid argument to 'AliasTable::setup': weights");
+		}
+		total += weights[i];
+	}
+	if (size == 0 || total <= 0) {
+		throw std::invalid_argument("Invalid argument to 'AliasTable::setup': weights");
+	}
+
+	probability_.assign(size, 1);
+	alias_.resize(size);
+
+	// scale so the average bin holds 1, and sort the bins into under and over full
+	std::vector<double> scaled(size);
+	std::vector<unsigned int> under;
+	std::vector<unsigned int> over;
+	for (unsigned int i = 0; i < size; i++) {
+		scaled[i] = weights[i] * size / total;
+		alias_[i] = i;
+		if (scaled[i] < 1) {
+			under.push_back(i);
+		}
+		else {
+			over.push_back(i);
+		}
+	}
+
+	// fill each under full bin from an over full one, which may then become under full
+	while (!under.empty() && !over.empty()) {
+		unsigned int less = under.back();
+		under.pop_back();
+		unsigned int more = over.back();
+		over.pop_back();
+
+		probability_[less] = scaled[less];
+		alias_[less] = more;
+		scaled[more] = (scaled[more] + scaled[less]) - 1;
+		if (scaled[more] < 1) {
+			under.push_back(more);
+		}
+		else {
+			over.push_back(more);
+		}
+	}
+	// any bins left are full (up to rounding), so keep their probability of 1
+}
+
+unsigned int AliasTable::pick(unsigned int bin, float fraction) const
+{
+	// a uniform number rounding up to 1 lands past the last bin
+	if (bin >= probability_.size()) {
+		bin = probability_.size() - 1;
+		fraction = 1;
+	}
+	return fraction < probability_[bin] ? bin : alias_[bin];
+}
+
+unsigned int AliasTable::sample(float uniform) const
+{
+	float scaled = uniform * probability_.size();
+	unsigned int bin = scaled;
+	return pick(bin, scaled - bin);
+}
+
+void AliasTable::sample(const float* uniforms, unsigned int* indices, unsigned int count) const
+{
+	// scale and split four uniform numbers at a time, then look each one up
+	const simd::float4 size = simd::float4::set1(probability_.size());
+	int32_t bins[simd::kLanes];
+	float fractions[simd::kLanes];
+	unsigned int n = 0;
+	for (; n + simd::kLanes <= count; n += simd::kLanes) {
+		simd::float4 scaled = simd::float4::load(&uniforms[n]) * size;
+		simd::int4 whole = simd::truncate(scaled);
+		whole.store(bins);
+		(scaled - simd::toFloat(whole)).store(fractions);
+		for (unsigned int lane = 0; lane < simd::kLanes; lane++) {
+			indices[n + lane] = pick(bins[lane], fractions[lane]);
+		}
+	}
+	for (; n < count; n++) {
+		indices[n] = sample(uniforms[n]);
+	}
+}
@@ -0,0 +1,61 @@
+/***** Sampler.h *****/
+
+/*
+Drawing an index from a discrete distribution of non-negative (not necessarily
+normalised) weights, given a uniform random number in [0, 1).
+
+sampler::sample() is for distributions built for a single draw, as the arpeggiator's
+are on every step: it sums the weights four at a time and counts the bins whose
+running sum lies at or below the target, so there is no divide and no early exit.
+
+AliasTable is for distributions reused over many draws (Walker's alias method, built
+with Vose's algorithm): building it is O(n), after which each draw is O(1) whatever
+the number of bins. sample() on a buffer of uniform numbers draws a whole batch, for
+generating sequences offline.
+
+Bins with zero weight are never drawn. The random numbers are passed in, so these
+work with any generator.
+*/
+
+#pragma once
+
+#include <vector>
+
+namespace sampler {
+
+// index of the bin of weights (size of them) in which uniform falls
+unsigned int sample(const float* weights, unsigned int size, float uniform);
+
+inline unsigned int sample(const std::vector<float>& weights, float uniform)
+{
+	return sample(weights.data(), weights.size(), uniform);
+}
+
+} // namespace sampler
+
+class AliasTable {
+public:
+	AliasTable();
+
+	AliasTable(const float* weights, unsigned int size);
+
+	// build the table (allocates: not for the audio thread)
+	void setup(const float* weights, unsigned int size);
+
+	unsigned int size() const {return probability_.size(); }
+
+	// draw one index
+	unsigned int sample(float uniform) const;
+
+	// draw count indices, one for each of count uniform numbers
+	void sample(const float* uniforms, unsigned int* indices, unsigned int count) const;
+
+	~AliasTable() {};
+
+private:
+	std::vector<float> probability_;		// chance of keeping each bin rather than taking its alias
+	std::vector<unsigned int> alias_;		// bin taken instead
+
+	// the bin chosen by a scaled uniform number with whole part bin
+	unsigned int pick(unsigned int bin, float fraction) const;
+};
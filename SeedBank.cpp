@@ -0,0 +1,100 @@
+/***** SeedBank.cpp *****/
+
+#include "SeedBank.h"
+
+#include <memory>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char SeedBank::kMagic[8] = {'A', 'R', 'P', 'S', 'E', 'E', 'D', '1'};
+
+// the built-in sequences: 4 bars of 4 beats of 4 sub-beats each
+static const unsigned int kBuiltInSize = 4;
+static const unsigned int kBuiltInLength = 64;
+
+// {MIDI note (-1 for none), amplitude in hundredths} for every step of each sequence
+static const SeedBank::Step kBuiltInSteps[kBuiltInSize * kBuiltInLength] {
+	{48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100},
+	{48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100},
+	{48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100},
+	{48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100}, {48, 100},
+
+	{48, 100}, {51, 90}, {55, 90}, {48, 90}, {51, 100}, {55, 90}, {48, 90}, {51, 90}, {55, 100}, {48, 90}, {51, 90}, {55, 90}, {48, 100}, {51, 90}, {55, 90}, {48, 90},
+	{51, 100}, {55, 90}, {48, 90}, {51, 90}, {55, 100}, {48, 90}, {51, 90}, {55, 90}, {48, 100}, {51, 90}, {55, 90}, {48, 90}, {51, 100}, {55, 90}, {48, 90}, {51, 90},
+	{48, 100}, {51, 90}, {55, 90}, {48, 90}, {51, 100}, {55, 90}, {48, 90}, {51, 90}, {55, 100}, {48, 90}, {51, 90}, {55, 90}, {48, 100}, {51, 90}, {55, 90}, {48, 90},
+	{51, 100}, {55, 90}, {48, 90}, {51, 90}, {55, 100}, {48, 90}, {51, 90}, {55, 90}, {48, 100}, {51, 90}, {55, 90}, {48, 90}, {51, 100}, {55, 90}, {48, 90}, {51, 90},
+
+	{48, 100}, {51, 90}, {55, 90}, {60, 90}, {62, 100}, {63, 90}, {67, 90}, {72, 90}, {74, 100}, {75, 90}, {79, 90}, {84, 90}, {86, 100}, {87, 90}, {93, 90}, {91, 90},
+	{48, 100}, {51, 90}, {55, 90}, {60, 90}, {62, 100}, {63, 90}, {67, 90}, {72, 90}, {74, 100}, {75, 90}, {79, 90}, {84, 90}, {86, 100}, {87, 90}, {93, 90}, {91, 90},
+	{48, 100}, {51, 90}, {55, 90}, {60, 90}, {62, 100}, {63, 90}, {67, 90}, {72, 90}, {74, 100}, {75, 90}, {79, 90}, {84, 90}, {86, 100}, {87, 90}, {93, 90}, {91, 90},
+	{48, 100}, {51, 90}, {55, 90}, {60, 90}, {62, 100}, {63, 90}, {67, 90}, {72, 90}, {74, 100}, {75, 90}, {79, 90}, {84, 90}, {86, 100}, {87, 90}, {93, 90}, {91, 90},
+
+	{60, 100}, {72, 100}, {-1, 40}, {60, 100}, {72, 100}, {-1, 40}, {60, 100}, {72, 120}, {-1, 40}, {60, 100}, {72, 100}, {-1, 40}, {60, 100}, {72, 100}, {-1, 40}, {-1, 40},
+	{60, 100}, {63, 100}, {-1, 40}, {60, 100}, {63, 100}, {-1, 40}, {60, 100}, {63, 120}, {-1, 40}, {60, 100}, {63, 100}, {-1, 40}, {60, 100}, {63, 100}, {-1, 40}, {-1, 40},
+	{60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 120}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {-1, 40},
+	{60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 120}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {60, 100}, {67, 100}, {-1, 40}, {-1, 40}
+};
+
+SeedBank::SeedBank(const Step* steps, unsigned int size, unsigned int length, unsigned int subBeatsPerBeat,
+				   unsigned int beatsPerBar, unsigned int barsPerPattern, void* mapping, size_t mappingSize)
+	: steps_(steps), size_(size), length_(length), subBeatsPerBeat_(subBeatsPerBeat), beatsPerBar_(beatsPerBar),
+	  barsPerPattern_(barsPerPattern), mapping_(mapping), mappingSize_(mappingSize)
+{
+}
+
+std::shared_ptr<const SeedBank> SeedBank::builtIn()
+{
+	// one bank for the whole process
+	static const std::shared_ptr<const SeedBank> bank(new SeedBank(kBuiltInSteps, kBuiltInSize, kBuiltInLength, 4, 4, 4, nullptr, 0));
+	return bank;
+}
+
+std::shared_ptr<const SeedBank> SeedBank::open(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		rt_printf("Unable to open the seed bank '%s'\n", path.c_str());
+		return nullptr;
+	}
+	struct stat status;
+	if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(FileHeader)) {
+		rt_printf("'%s' is not a seed bank\n", path.c_str());
+		close(fd);
+		return nullptr;
+	}
+	size_t fileSize = status.st_size;
+	// read-only and private: pages are only loaded when a sequence is read, and can be dropped again at any time
+	void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		rt_printf("Unable to map the seed bank '%s'\n", path.c_str());
+		return nullptr;
+	}
+	
+	// only the header is checked: the steps are used as they are
+	const FileHeader* header = (const FileHeader*)mapping;
+	uint64_t stepsSize = (uint64_t)header->size * header->length * sizeof(Step);
+	if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->headerSize < sizeof(FileHeader) ||
+		header->size == 0 || header->length == 0 || header->headerSize + stepsSize > fileSize) {
+		rt_printf("'%s' is not a valid seed bank\n", path.c_str());
+		munmap(mapping, fileSize);
+		return nullptr;
+	}
+	
+	const Step* steps = (const Step*)((const char*)mapping + header->headerSize);
+	return std::shared_ptr<const SeedBank>(new SeedBank(steps, header->size, header->length, header->subBeatsPerBeat,
+														header->beatsPerBar, header->barsPerPattern, mapping, fileSize));
+}
+
+SeedBank::~SeedBank()
+{
+	if (mapping_ != nullptr) {
+		munmap(mapping_, mappingSize_);
+	}
+}
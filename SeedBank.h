@@ -0,0 +1,85 @@
+/***** SeedBank.h *****/
+
+/*
+Immutable set of seed sequences for the arpeggiator: size() sequences of length()
+steps, each step a MIDI note (or none) and an amplitude. Sequence n starts at
+n * length() in a single block, so any sequence is found in constant time.
+
+The four built-in sequences are compiled in. Larger banks are imported offline from
+MIDI files (tools/SeedImporter.cpp) and mapped straight from the file, so opening one
+parses nothing and only the sequences actually played are ever read into memory.
+
+Like wavetable banks, seed banks are only handed out through shared pointers to
+const, so any number of arpeggiators can use the same one.
+
+File format, in native byte order (little-endian on Bela):
+	FileHeader		magic "ARPSEED1", then the sizes and the grid the sequences were
+					quantised to (see below)
+	Step			size * length steps, sequence by sequence, from headerSize bytes in
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+class SeedBank {
+public:
+	// one step of a sequence, as stored
+	struct Step {
+		int8_t note;					// MIDI note, negative for none
+		uint8_t amplitude;				// amplitude in hundredths (MIDI velocity 100 is 1.0)
+	};
+	static const uint8_t kRestAmplitude = 40;		// amplitude of the steps without a note in the built-in sequences
+
+	struct FileHeader {
+		char magic[8];					// kMagic
+		uint32_t headerSize;			// bytes before the first step
+		uint32_t size;					// number of sequences
+		uint32_t length;				// steps per sequence
+		uint32_t subBeatsPerBeat;		// grid the sequences were quantised to
+		uint32_t beatsPerBar;
+		uint32_t barsPerPattern;
+	};
+	static const char kMagic[8];
+
+	// the sequences compiled in
+	static std::shared_ptr<const SeedBank> builtIn();
+	// map a bank file (nullptr, with a message, if it cannot be opened or is not a valid bank)
+	static std::shared_ptr<const SeedBank> open(const std::string& path);
+
+	unsigned int size() const {return size_; }				// number of sequences
+	unsigned int length() const {return length_; }			// steps per sequence
+	unsigned int subBeatsPerBeat() const {return subBeatsPerBeat_; }
+	unsigned int beatsPerBar() const {return beatsPerBar_; }
+	unsigned int barsPerPattern() const {return barsPerPattern_; }
+
+	// first step of sequence n (no range check)
+	const Step* sequence(unsigned int n) const {return steps_ + n * length_; }
+
+	// the values of a step as the arpeggiator uses them
+	static int note(const Step& step) {return step.note < 0 ? -1 : step.note; }
+	static float amplitude(const Step& step) {return step.amplitude / 100.0f; }
+
+	~SeedBank();
+
+private:
+	SeedBank(const Step* steps, unsigned int size, unsigned int length, unsigned int subBeatsPerBeat,
+			 unsigned int beatsPerBar, unsigned int barsPerPattern, void* mapping, size_t mappingSize);
+
+	// banks are shared, never copied
+	SeedBank(const SeedBank&) = delete;
+	SeedBank& operator=(const SeedBank&) = delete;
+
+	const Step* steps_;
+	unsigned int size_;
+	unsigned int length_;
+	unsigned int subBeatsPerBeat_;
+	unsigned int beatsPerBar_;
+	unsigned int barsPerPattern_;
+
+	void* mapping_;						// the mapped file (nullptr for the built-in bank)
+	size_t mappingSize_;
+};
@@ -0,0 +1,493 @@
+/***** Simd.h *****/
+
+/*
+Minimal 4-lane vector types for the DSP kernels.
+Maps onto NEON on Bela, SSE2 on x86 hosts, and plain arrays everywhere else
+(or when SIMD_SCALAR is defined), so the same kernel source builds on all of them.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(SIMD_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#elif !defined(SIMD_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#endif
+
+namespace simd {
+
+const unsigned int kLanes = 4;
+
+// 4 x int32
+struct int4 {
+#if SIMD_NEON
+	int32x4_t v;
+#elif SIMD_SSE
+	__m128i v;
+#else
+	int32_t v[4];
+#endif
+
+	static int4 set1(int32_t x)
+	{
+		int4 r;
+#if SIMD_NEON
+		r.v = vdupq_n_s32(x);
+#elif SIMD_SSE
+		r.v = _mm_set1_epi32(x);
+#else
+		for (unsigned int i = 0; i < 4; i++) r.v[i] = x;
+#endif
+		return r;
+	}
+
+	void store(int32_t* p) const
+	{
+#if SIMD_NEON
+		vst1q_s32(p, v);
+#elif SIMD_SSE
+		_mm_storeu_si128((__m128i*)p, v);
+#else
+		for (unsigned int i = 0; i < 4; i++) p[i] = v[i];
+#endif
+	}
+};
+
+// 4 x uint32 (phase accumulators wrap modulo 2^32)
+struct uint4 {
+#if SIMD_NEON
+	uint32x4_t v;
+#elif SIMD_SSE
+	__m128i v;
+#else
+	uint32_t v[4];
+#endif
+
+	static uint4 load(const uint32_t* p)
+	{
+		uint4 r;
+#if SIMD_NEON
+		r.v = vld1q_u32(p);
+#elif SIMD_SSE
+		r.v = _mm_loadu_si128((const __m128i*)p);
+#else
+		for (unsigned int i = 0; i < 4; i++) r.v[i] = p[i];
+#endif
+		return r;
+	}
+
+	static uint4 set1(uint32_t x)
+	{
+		uint4 r;
+#if SIMD_NEON
+		r.v = vdupq_n_u32(x);
+#elif SIMD_SSE
+		r.v = _mm_set1_epi32((int32_t)x);
+#else
+		for (unsigned int i = 0; i < 4; i++) r.v[i] = x;
+#endif
+		return r;
+	}
+
+	void store(uint32_t* p) const
+	{
+#if SIMD_NEON
+		vst1q_u32(p, v);
+#elif SIMD_SSE
+		_mm_storeu_si128((__m128i*)p, v);
+#else
+		for (unsigned int i = 0; i < 4; i++) p[i] = v[i];
+#endif
+	}
+};
+
+// 4 x float
+struct float4 {
+#if SIMD_NEON
+	float32x4_t v;
+#elif SIMD_SSE
+	__m128 v;
+#else
+	float v[4];
+#endif
+
+	static float4 load(const float* p)
+	{
+		float4 r;
+#if SIMD_NEON
+		r.v = vld1q_f32(p);
+#elif SIMD_SSE
+		r.v = _mm_loadu_ps(p);
+#else
+		for (unsigned int i = 0; i < 4; i++) r.v[i] = p[i];
+#endif
+		return r;
+	}
+
+	static float4 set1(float x)
+	{
+		float4 r;
+#if SIMD_NEON
+		r.v = vdupq_n_f32(x);
+#elif SIMD_SSE
+		r.v = _mm_set1_ps(x);
+#else
+		for (unsigned int i = 0; i < 4; i++) r.v[i] = x;
+#endif
+		return r;
+	}
+
+	void store(float* p) const
+	{
+#if SIMD_NEON
+		vst1q_f32(p, v);
+#elif SIMD_SSE
+		_mm_storeu_ps(p, v);
+#else
+		for (unsigned int i = 0; i < 4; i++) p[i] = v[i];
+#endif
+	}
+};
+
+inline float4 operator+(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vaddq_f32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_add_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i];
+#endif
+	return r;
+}
+
+inline float4 operator-(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vsubq_f32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_sub_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i];
+#endif
+	return r;
+}
+
+inline float4 operator*(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vmulq_f32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_mul_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i];
+#endif
+	return r;
+}
+
+// ARMv7 NEON has no divide: reciprocal estimate refined by two Newton-Raphson steps
+inline float4 operator/(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	float32x4_t reciprocal = vrecpeq_f32(b.v);
+	reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+	reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+	r.v = vmulq_f32(a.v, reciprocal);
+#elif SIMD_SSE
+	r.v = _mm_div_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] / b.v[i];
+#endif
+	return r;
+}
+
+inline float4 min(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vminq_f32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_min_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+#endif
+	return r;
+}
+
+inline float4 max(float4 a, float4 b)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vmaxq_f32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_max_ps(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+#endif
+	return r;
+}
+
+// convert to integer, rounding towards zero
+inline int4 truncate(float4 a)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vcvtq_s32_f32(a.v);
+#elif SIMD_SSE
+	r.v = _mm_cvttps_epi32(a.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = (int32_t)a.v[i];
+#endif
+	return r;
+}
+
+inline float4 toFloat(int4 a)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vcvtq_f32_s32(a.v);
+#elif SIMD_SSE
+	r.v = _mm_cvtepi32_ps(a.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = (float)a.v[i];
+#endif
+	return r;
+}
+
+inline int4 operator&(int4 a, int4 b)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vandq_s32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_and_si128(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] & b.v[i];
+#endif
+	return r;
+}
+
+inline int4 operator|(int4 a, int4 b)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vorrq_s32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_or_si128(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] | b.v[i];
+#endif
+	return r;
+}
+
+// shift left by the same (compile-time) amount in every lane
+template <int kShift>
+inline int4 shiftLeft(int4 a)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vshlq_n_s32(a.v, kShift);
+#elif SIMD_SSE
+	r.v = _mm_slli_epi32(a.v, kShift);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] << kShift);
+#endif
+	return r;
+}
+
+// arithmetic shift right by the same (compile-time) amount in every lane
+template <int kShift>
+inline int4 shiftRight(int4 a)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vshrq_n_s32(a.v, kShift);
+#elif SIMD_SSE
+	r.v = _mm_srai_epi32(a.v, kShift);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] >> kShift;
+#endif
+	return r;
+}
+
+// reinterpret the bits of each lane
+inline int4 asInt(float4 a)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vreinterpretq_s32_f32(a.v);
+#elif SIMD_SSE
+	r.v = _mm_castps_si128(a.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) memcpy(&r.v[i], &a.v[i], sizeof(float));
+#endif
+	return r;
+}
+
+inline float4 asFloat(int4 a)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vreinterpretq_f32_s32(a.v);
+#elif SIMD_SSE
+	r.v = _mm_castsi128_ps(a.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) memcpy(&r.v[i], &a.v[i], sizeof(float));
+#endif
+	return r;
+}
+
+inline int4 operator-(int4 a, int4 b)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vsubq_s32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_sub_epi32(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i];
+#endif
+	return r;
+}
+
+// all bits set in the lanes where a <= b, clear elsewhere
+inline int4 lessEqual(float4 a, float4 b)
+{
+	int4 r;
+#if SIMD_NEON
+	r.v = vreinterpretq_s32_u32(vcleq_f32(a.v, b.v));
+#elif SIMD_SSE
+	r.v = _mm_castps_si128(_mm_cmple_ps(a.v, b.v));
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] <= b.v[i] ? -1 : 0;
+#endif
+	return r;
+}
+
+// running sum across the lanes: {a0, a0 + a1, a0 + a1 + a2, a0 + a1 + a2 + a3}
+inline float4 prefixSum(float4 a)
+{
+	float4 r;
+#if SIMD_NEON
+	float32x4_t zero = vdupq_n_f32(0);
+	float32x4_t pairs = vaddq_f32(a.v, vextq_f32(zero, a.v, 3));
+	r.v = vaddq_f32(pairs, vextq_f32(zero, pairs, 2));
+#elif SIMD_SSE
+	__m128 pairs = _mm_add_ps(a.v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(a.v), 4)));
+	r.v = _mm_add_ps(pairs, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(pairs), 8)));
+#else
+	float pairs[4] = {a.v[0], a.v[1] + a.v[0], a.v[2] + a.v[1], a.v[3] + a.v[2]};
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = i < 2 ? pairs[i] : pairs[i] + pairs[i - 2];
+#endif
+	return r;
+}
+
+// the last lane copied to every lane
+inline float4 broadcastLast(float4 a)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vdupq_lane_f32(vget_high_f32(a.v), 1);
+#elif SIMD_SSE
+	r.v = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 3, 3, 3));
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[3];
+#endif
+	return r;
+}
+
+// wrapping add
+inline uint4 operator+(uint4 a, uint4 b)
+{
+	uint4 r;
+#if SIMD_NEON
+	r.v = vaddq_u32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_add_epi32(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i];
+#endif
+	return r;
+}
+
+inline uint4 operator&(uint4 a, uint4 b)
+{
+	uint4 r;
+#if SIMD_NEON
+	r.v = vandq_u32(a.v, b.v);
+#elif SIMD_SSE
+	r.v = _mm_and_si128(a.v, b.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] & b.v[i];
+#endif
+	return r;
+}
+
+// logical shift right by the same (run-time) amount in every lane
+inline uint4 operator>>(uint4 a, unsigned int shift)
+{
+	uint4 r;
+#if SIMD_NEON
+	r.v = vshlq_u32(a.v, vdupq_n_s32(-(int32_t)shift));
+#elif SIMD_SSE
+	r.v = _mm_srl_epi32(a.v, _mm_cvtsi32_si128(shift));
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = a.v[i] >> shift;
+#endif
+	return r;
+}
+
+// convert to float - lanes must be below 2^31
+inline float4 toFloat(uint4 a)
+{
+	float4 r;
+#if SIMD_NEON
+	r.v = vcvtq_f32_u32(a.v);
+#elif SIMD_SSE
+	r.v = _mm_cvtepi32_ps(a.v);
+#else
+	for (unsigned int i = 0; i < 4; i++) r.v[i] = (float)a.v[i];
+#endif
+	return r;
+}
+
+// sum of the 4 lanes
+inline float sum(float4 a)
+{
+#if SIMD_NEON
+	float32x2_t pair = vpadd_f32(vget_low_f32(a.v), vget_high_f32(a.v));
+	return vget_lane_f32(pair, 0) + vget_lane_f32(pair, 1);
+#elif SIMD_SSE
+	__m128 shuffled = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(a.v, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+#else
+	return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+#endif
+}
+
+inline int32_t sum(int4 a)
+{
+#if SIMD_NEON
+	int32x2_t pair = vpadd_s32(vget_low_s32(a.v), vget_high_s32(a.v));
+	return vget_lane_s32(pair, 0) + vget_lane_s32(pair, 1);
+#elif SIMD_SSE
+	__m128i sums = _mm_add_epi32(a.v, _mm_shuffle_epi32(a.v, _MM_SHUFFLE(2, 3, 0, 1)));
+	sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtsi128_si32(sums);
+#else
+	return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+#endif
+}
+
+} // namespace simd
@@ -0,0 +1,56 @@
+/***** SpscQueue.h *****/
+
+/*
+Fixed capacity ring buffer for passing items from one thread to one other, without
+locks: push() and pop() each finish in a bounded number of steps whatever the other
+thread is doing, so the audio thread can use either end.
+
+The read and write counts run freely (wrapping modulo 2^32) and the capacity is a
+power of two, so the item index is the count masked and the number of items is the
+difference of the counts.
+*/
+
+#pragma once
+
+#include <atomic>
+
+template <typename T, unsigned int kCapacity>
+class SpscQueue {
+public:
+	static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	// producer only: false (and nothing written) if the queue is full
+	bool push(const T& item)
+	{
+		unsigned int write = write_.load(std::memory_order_relaxed);
+		if (write - read_.load(std::memory_order_acquire) == kCapacity) {
+			return false;
+		}
+		items_[write & (kCapacity - 1)] = item;
+		write_.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only: false (and item untouched) if the queue is empty
+	bool pop(T& item)
+	{
+		unsigned int read = read_.load(std::memory_order_relaxed);
+		if (read == write_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items_[read & (kCapacity - 1)];
+		read_.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	// either thread: exact for the calling end, possibly out of date for the other
+	unsigned int size() const
+	{
+		return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+	}
+
+private:
+	T items_[kCapacity];
+	std::atomic<unsigned int> write_ {0};		// number of items pushed
+	std::atomic<unsigned int> read_ {0};		// number of items popped
+};
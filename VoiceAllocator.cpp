@@ -0,0 +1,316 @@
+/***** VoiceAllocator.cpp *****/
+
+#include "VoiceAllocator.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+const unsigned int VoiceAllocator::kMaxVoices;
+const unsigned int VoiceAllocator::kChunkSize;
+const unsigned int VoiceAllocator::kVoicesPerBank;
+
+void VoiceAllocator::setup(float sampleRate,
+						   std::shared_ptr<const WavetableBank> bank,
+						   unsigned int unisonVoices,
+						   std::vector<float> detuneRatios)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		oscillators_[v].setup(sampleRate, bank, unisonVoices, detuneRatios);
+		// the envelopes are evaluated at control rate
+		ampEnvelopes_[v].setSampleRate(sampleRate / kControlPeriod);
+		filterEnvelopes_[v].setSampleRate(sampleRate / kControlPeriod);
+		amplitudes_[v] = 0;
+		levels_[v] = 0;
+		starts_[v] = 0;
+		ampRamps_[v].reset(0);
+		sounding_[v] = false;
+	}
+	for (unsigned int b = 0; b < kMaxVoices / kVoicesPerBank; b++) {
+		filters_[b].setup(sampleRate, MoogFilter::kLowpass12);
+	}
+
+	noteCount_ = 0;
+	lastVoice_ = -1;
+	controlPhase_ = 0;
+
+	filterCutoff_ = 1000;
+	filterSensitivity_ = 0;
+	filterResonance_ = 0;
+}
+
+// choose the voice for a new note
+unsigned int VoiceAllocator::allocate()
+{
+	unsigned int chosen = 0;
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		// a free voice
+		if (!ampEnvelopes_[v].isActive()) {
+			return v;
+		}
+		// otherwise the quietest, then the oldest
+		if (levels_[v] < levels_[chosen] || (levels_[v] == levels_[chosen] && starts_[v] < starts_[chosen])) {
+			chosen = v;
+		}
+	}
+	return chosen;
+}
+
+// start a note, releasing the previous one
+void VoiceAllocator::noteOn(float frequency, float amplitude)
+{
+	if (lastVoice_ >= 0) {
+		ampEnvelopes_[lastVoice_].release();
+		filterEnvelopes_[lastVoice_].release();
+	}
+
+	unsigned int v = allocate();
+	// a free voice starts from silence, with a control update straight away so that its envelopes
+	// start now rather than at the next shared update; a stolen one ramps on from where it was
+	if (!sounding_[v]) {
+		ampRamps_[v].reset(0);
+		controlPhase_ = 0;
+	}
+	sounding_[v] = true;
+	oscillators_[v].setFrequency(frequency);
+	amplitudes_[v] = amplitude;
+	starts_[v] = noteCount_++;
+
+	// trigger envelopes
+	ampEnvelopes_[v].trigger();
+	filterEnvelopes_[v].trigger();
+
+	lastVoice_ = v;
+}
+
+// release every sounding voice
+void VoiceAllocator::releaseAll()
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		ampEnvelopes_[v].release();
+		filterEnvelopes_[v].release();
+	}
+	lastVoice_ = -1;
+}
+
+void VoiceAllocator::setUnisonVoices(unsigned int voices)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		oscillators_[v].setVoices(voices);
+	}
+}
+
+void VoiceAllocator::setDetune(float detune)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		oscillators_[v].setDetune(detune);
+	}
+}
+
+void VoiceAllocator::setTable(float mix)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		oscillators_[v].setTable(mix);
+	}
+}
+
+void VoiceAllocator::setFilterCutoff(float cutoff) {filterCutoff_ = cutoff; }
+void VoiceAllocator::setFilterSensitivity(float sensitivity) {filterSensitivity_ = sensitivity; }
+void VoiceAllocator::setFilterResonance(float resonance) {filterResonance_ = resonance; }
+
+void VoiceAllocator::setFilterOversampling(unsigned int factor)
+{
+	for (unsigned int b = 0; b < kMaxVoices / kVoicesPerBank; b++) {
+		filters_[b].set_oversampling(factor);
+	}
+}
+
+void VoiceAllocator::setAmpAttackTime(float attackTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		ampEnvelopes_[v].setAttackTime(attackTime);
+	}
+}
+
+void VoiceAllocator::setAmpDecayTime(float decayTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		ampEnvelopes_[v].setDecayTime(decayTime);
+	}
+}
+
+void VoiceAllocator::setAmpSustainLevel(float sustainLevel)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		ampEnvelopes_[v].setSustainLevel(sustainLevel);
+	}
+}
+
+void VoiceAllocator::setAmpReleaseTime(float releaseTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		ampEnvelopes_[v].setReleaseTime(releaseTime);
+	}
+}
+
+void VoiceAllocator::setFilterAttackTime(float attackTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		filterEnvelopes_[v].setAttackTime(attackTime);
+	}
+}
+
+void VoiceAllocator::setFilterDecayTime(float decayTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		filterEnvelopes_[v].setDecayTime(decayTime);
+	}
+}
+
+void VoiceAllocator::setFilterSustainLevel(float sustainLevel)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		filterEnvelopes_[v].setSustainLevel(sustainLevel);
+	}
+}
+
+void VoiceAllocator::setFilterReleaseTime(float releaseTime)
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		filterEnvelopes_[v].setReleaseTime(releaseTime);
+	}
+}
+
+// number of voices currently sounding
+unsigned int VoiceAllocator::activeVoices()
+{
+	unsigned int active = 0;
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		if (sounding_[v]) {
+			active++;
+		}
+	}
+	return active;
+}
+
+// true when no voice is sounding
+bool VoiceAllocator::isIdle()
+{
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		if (sounding_[v]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Fill a stereo block with the sum of the voices
+void VoiceAllocator::processBlock(float* outLeft, float* outRight, unsigned int frames)
+{
+	for (unsigned int n = 0; n < frames; n++) {
+		outLeft[n] = 0;
+		outRight[n] = 0;
+	}
+
+	// silent voices cost nothing
+	bool active[kMaxVoices];
+	bool anyActive = false;
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		active[v] = sounding_[v];
+		anyActive = anyActive || active[v];
+		if (!active[v]) {
+			levels_[v] = 0;
+		}
+	}
+	if (!anyActive) {
+		return;
+	}
+
+	for (unsigned int start = 0; start < frames; start += kChunkSize) {
+		unsigned int count = std::min(kChunkSize, frames - start);
+
+		// the oscillators render a chunk at a time
+		for (unsigned int v = 0; v < kMaxVoices; v++) {
+			if (active[v]) {
+				oscillators_[v].processBlock(buffersLeft_[v].data(), buffersRight_[v].data(), count);
+			}
+		}
+
+		// then the amplitudes and filters run a control period (or what is left of it) at a time
+		unsigned int n = 0;
+		while (n < count) {
+			// control update: new envelope values, ramped to over the next control period
+			if (controlPhase_ == 0) {
+				for (unsigned int v = 0; v < kMaxVoices; v++) {
+					if (!active[v]) {
+						continue;
+					}
+					ampRamps_[v].setTarget(amplitudes_[v] * ampEnvelopes_[v].process());	// note amplitude * envelope value
+					float filterControl = filterEnvelopes_[v].process();
+					float cutoff = filterCutoff_ + filterControl * filterSensitivity_;
+					filters_[v / kVoicesPerBank].ramp_params(filterLane(v, 0), cutoff, filterResonance_, kControlPeriod);
+					filters_[v / kVoicesPerBank].ramp_params(filterLane(v, 1), cutoff, filterResonance_, kControlPeriod);
+				}
+				controlPhase_ = kControlPeriod;
+			}
+			unsigned int length = std::min(controlPhase_, count - n);
+
+			for (unsigned int v = 0; v < kMaxVoices; v++) {
+				if (!active[v]) {
+					continue;
+				}
+				for (unsigned int k = n; k < n + length; k++) {
+					float amp = ampRamps_[v].process();
+					buffersLeft_[v][k] *= amp;
+					buffersRight_[v][k] *= amp;
+				}
+			}
+
+			// apply filters: each bank filters both channels of kVoicesPerBank voices
+			for (unsigned int b = 0; b < kMaxVoices / kVoicesPerBank; b++) {
+				float* lanes[MoogFilterBank::kLanes] = {};
+				bool bankActive = false;
+				for (unsigned int v = b * kVoicesPerBank; v < (b + 1) * kVoicesPerBank; v++) {
+					if (active[v]) {
+						lanes[filterLane(v, 0)] = &buffersLeft_[v][n];
+						lanes[filterLane(v, 1)] = &buffersRight_[v][n];
+						bankActive = true;
+					}
+				}
+				if (bankActive) {
+					filters_[b].process_block(lanes, lanes, length);
+				}
+			}
+
+			n += length;
+			controlPhase_ -= length;
+		}
+
+		for (unsigned int v = 0; v < kMaxVoices; v++) {
+			if (!active[v]) {
+				continue;
+			}
+			for (n = 0; n < count; n++) {
+				outLeft[start + n] += buffersLeft_[v][n];
+				outRight[start + n] += buffersRight_[v][n];
+			}
+		}
+	}
+
+	for (unsigned int v = 0; v < kMaxVoices; v++) {
+		if (!active[v]) {
+			continue;
+		}
+		levels_[v] = ampRamps_[v].getValue();
+
+		// a finished voice stops once its filters have rung out, ready to start from silence
+		MoogFilterBank& filters = filters_[v / kVoicesPerBank];
+		if (!ampEnvelopes_[v].isActive() && filters.is_settled(filterLane(v, 0)) && filters.is_settled(filterLane(v, 1))) {
+			filters.clear(filterLane(v, 0));
+			filters.clear(filterLane(v, 1));
+			ampRamps_[v].reset(0);
+			levels_[v] = 0;
+			sounding_[v] = false;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/***** VoiceAllocator.h *****/
+
+/*
+Fixed pool of lead synth voices, so that arpeggiator notes can ring on through
+their release while the next note plays.
+Each voice is a 2D wavetable oscillator, with its unison voices panned across the
+stereo field, and its own amplitude and filter envelopes and pair of Moog filters.
+The filters of pairs of voices (left and right for each) share a MoogFilterBank.
+The envelopes run at control rate (see ControlRate.h): the amplitude is ramped
+between envelope values and the filters ramp their coefficients.
+Per-voice state is kept as parallel arrays (structure of arrays) sized at compile
+time, and everything is set up in setup(): nothing is allocated while notes are
+being played.
+
+A voice keeps sounding after its envelope has finished until its filters have
+settled, and is then skipped entirely (oscillator, envelopes and filters) until it
+plays another note.
+
+A new note takes a free voice if there is one, otherwise it steals the quietest
+voice (the oldest, if several are equally quiet). Each new note releases the
+previous one, as the arpeggiator plays one line.
+*/
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include "Wavetable2D.h"
+#include "WavetableBank.h"
+#include "MoogFilterBank.h"
+#include "ADSR.h"
+#include "ControlRate.h"
+
+class VoiceAllocator {
+public:
+	static const unsigned int kMaxVoices = 8;			// number of voices in the pool
+
+	VoiceAllocator() {}													// Default constructor
+
+	void setup(float sampleRate,										// Set parameters
+			   std::shared_ptr<const WavetableBank> bank,
+			   unsigned int unisonVoices = 1,
+			   std::vector<float> detuneRatios = {1.0});
+
+	void noteOn(float frequency, float amplitude);		// start a note, releasing the previous one
+	void releaseAll();									// release every sounding voice
+
+	// oscillator parameters, applied to every voice
+	void setUnisonVoices(unsigned int voices);
+	void setDetune(float detune);
+	void setTable(float mix);
+
+	// filter parameters: cutoff = cutoff + filter envelope * sensitivity
+	void setFilterCutoff(float cutoff);
+	void setFilterSensitivity(float sensitivity);
+	void setFilterResonance(float resonance);
+	void setFilterOversampling(unsigned int factor);		// run the filters at 1, 2 or 4 times the sample rate
+
+	// envelope parameters, applied to every voice
+	void setAmpAttackTime(float attackTime);
+	void setAmpDecayTime(float decayTime);
+	void setAmpSustainLevel(float sustainLevel);
+	void setAmpReleaseTime(float releaseTime);
+	void setFilterAttackTime(float attackTime);
+	void setFilterDecayTime(float decayTime);
+	void setFilterSustainLevel(float sustainLevel);
+	void setFilterReleaseTime(float releaseTime);
+
+	unsigned int activeVoices();						// number of voices currently sounding
+	bool isIdle();										// true when no voice is sounding
+
+	void processBlock(float* outLeft, float* outRight, unsigned int frames);	// Fill a stereo block with the sum of the voices
+
+	~VoiceAllocator() {}				// Destructor
+
+private:
+	static const unsigned int kChunkSize = 128;		// frames rendered by the oscillators at a time
+	static const unsigned int kVoicesPerBank = MoogFilterBank::kLanes / 2;	// voices (left and right) per filter bank
+
+	// filter bank lane of a voice's channel (0 left, 1 right)
+	static unsigned int filterLane(unsigned int voice, unsigned int channel) {return (voice % kVoicesPerBank) * 2 + channel; }
+
+	unsigned int allocate();			// choose the voice for a new note
+
+	// one entry per voice
+	std::array<Wavetable2D, kMaxVoices> oscillators_;
+	std::array<ADSR, kMaxVoices> ampEnvelopes_;
+	std::array<ADSR, kMaxVoices> filterEnvelopes_;
+	std::array<float, kMaxVoices> amplitudes_;		// note amplitude
+	std::array<float, kMaxVoices> levels_;			// output level at the end of the last block
+	std::array<unsigned long, kMaxVoices> starts_;	// note count when the voice was started
+	std::array<ControlRamp, kMaxVoices> ampRamps_;	// amplitude * envelope, ramped between control updates
+	std::array<bool, kMaxVoices> sounding_;			// from a note until the envelope has finished and the filters settled
+
+	unsigned long noteCount_;			// number of notes started
+	int lastVoice_;						// voice playing the latest note (-1 for none)
+	unsigned int controlPhase_;			// samples until the next control update (shared, restarted by a note on a free voice)
+
+	float filterCutoff_;				// filter cutoff before the envelope
+	float filterSensitivity_;			// cutoff change at full filter envelope
+	float filterResonance_;				// filter resonance
+
+	std::array<MoogFilterBank, kMaxVoices / kVoicesPerBank> filters_;
+
+	// output of each voice for one chunk
+	std::array<std::array<float, kChunkSize>, kMaxVoices> buffersLeft_;
+	std::array<std::array<float, kChunkSize>, kMaxVoices> buffersRight_;
+};
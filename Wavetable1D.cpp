@@ -14,116 +14,116 @@ wavetable-class: an example that implements a wavetable oscillator as a C++ clas
 // adapted from wavetable.cpp
 
 #include <cmath>
+#include <stdexcept>
 #include "Wavetable1D.h"
 
 // Constructor taking arguments for sample rate and table data
-Wavetable1D::Wavetable1D(float sampleRate, 
-						 std::vector<float>& wave1, 
+template <class Interpolation>
+BasicWavetable1D<Interpolation>::BasicWavetable1D(float sampleRate, 
+						 std::shared_ptr<const WavetableBank> bank, 
+						 unsigned int row,
 						 unsigned int voices,
-						 std::vector<float> detuneRatios,						 
-						 bool useInterpolation) 
+						 std::vector<float> detuneRatios) 
 {
-	setup(sampleRate, wave1, voices, detuneRatios, useInterpolation);
+	setup(sampleRate, bank, row, voices, detuneRatios);
 } 
 
-void Wavetable1D::setup(float sampleRate, 
-						std::vector<float>& wave1, 
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::setup(float sampleRate, 
+						std::shared_ptr<const WavetableBank> bank, 
+						unsigned int row,
 						unsigned int voices,
-						std::vector<float> detuneRatios,		
-						bool useInterpolation)
+						std::vector<float> detuneRatios)
 {
-	// It's faster to multiply than to divide on most platforms, so we save the inverse
-	// of the sample rate for use in the phase calculation later
-	inverseSampleRate_ = 1.0 / sampleRate;
-
-	// Copy other parameters
-	wave1_ = wave1;
-	useInterpolation_ = useInterpolation;
+	if (!bank) {
+		throw std::invalid_argument("Invalid argument to 'setup': bank");
+	}
+	if (row >= bank->numRows()) {
+		throw std::invalid_argument("Invalid argument to 'setup': row");
+	}
 	
-	// set up voices
-	voices_ = voices;
+	// Keep a reference to the shared tables
+	bank_ = bank;
+	row_ = row;
 	
-	// Initialise the starting state
-	readPointers_.resize(voices);
-	for (unsigned int i = 0; i < voices; i++) {
-		readPointers_[i] = 0;
-	}
-
-	detuneRatios_ = detuneRatios;
+	sampleRate_ = sampleRate;
+	mipmapLevel_ = 0;
+	mipmapMix_ = 0;
+	
+	// set up voices
+	voices_.setup(sampleRate, voices, detuneRatios);
 }
 
 // Set the oscillator frequency
-void Wavetable1D::setFrequency(float f) 
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::setFrequency(float f) 
 {
-	frequency_ = f;
+	voices_.setFrequency(f);
+	if (bank_) {
+		bank_->mipmapPosition(f, sampleRate_, mipmapLevel_, mipmapMix_);
+	}
 }
 
 // Get the oscillator frequency
-float Wavetable1D::getFrequency() 
+template <class Interpolation>
+float BasicWavetable1D<Interpolation>::getFrequency() 
 {
-	return frequency_;
+	return voices_.getFrequency();
 }		
 
 // set the detune ratio
-void Wavetable1D::setDetune(float detune) 
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::setDetune(float detune) 
 {
-	detune_ = detune;
+	voices_.setDetune(detune);
+}
+
+// set number of detuned voices
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::setVoices(unsigned int voices) 
+{
+	voices_.setVoices(voices);
 }
 
 // set the detune ratios for each voice
-void Wavetable1D::setDetuneRatios(std::vector<float> ratios) 
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::setDetuneRatios(const std::vector<float>& ratios) 
 {
-	detuneRatios_ = ratios;
+	voices_.setDetuneRatios(ratios);
 }
 	
 // Get the next sample and update the phase
-float Wavetable1D::process() {
-	float out = 0;
-	
+template <class Interpolation>
+float BasicWavetable1D<Interpolation>::process() {
+	float out;
+	processBlock(&out, 1);
+	return out;
+}
+
+// Fill a block of samples and update the phases
+template <class Interpolation>
+void BasicWavetable1D<Interpolation>::processBlock(float* out, unsigned int frames) {
 	// Make sure we have a valid table
-	if(wave1_.size() == 0) {
-		return out;
-	}
-	
-	// Increment and wrap the phase
-	for (unsigned int i = 0; i < voices_; i++) {
-		float frequency = frequency_ * (1.0 + detuneRatios_[i] * detune_);
-		readPointers_[i] += wave1_.size() * frequency * inverseSampleRate_;
-		while (readPointers_[i] >= wave1_.size())
-			readPointers_[i] -= wave1_.size();
-	}
-	
-	if(useInterpolation_) {
-		for (unsigned int i = 0; i < voices_; i++) {
-			// The pointer will take a fractional index. Look for the sample on
-			// either side which are indices we can actually read into the buffer.
-			// If we get to the end of the buffer, wrap around to 0.
-			int indexBelow = floorf(readPointers_[i]);
-			int indexAbove = indexBelow + 1;
-			if(indexAbove >= wave1_.size())
-				indexAbove = 0;
-		
-			// For linear interpolation, we need to decide how much to weigh each
-			// sample. The closer the fractional part of the index is to 0, the
-			// more weight we give to the "below" sample. The closer the fractional
-			// part is to 1, the more weight we give to the "above" sample.
-			float fractionAbove = readPointers_[i] - indexBelow;
-			float fractionBelow = 1.0 - fractionAbove;
-		
-			// Calculate the weighted average of the "below" and "above" samples
-		    out += fractionBelow * wave1_[indexBelow] +
-		    	   fractionAbove * wave1_[indexAbove];
+	if (!bank_) {
+		for (unsigned int n = 0; n < frames; n++) {
+			out[n] = 0;
 		}
+		return;
 	}
-	else {
-		for (unsigned int i = 0; i < voices_; i++) {
-			// Read the table without interpolation
-			out += wave1_[(int)readPointers_[i]];
-		}
-	}
-	
-	// reduce amplitude to compensate for multiple voices
-	out /= (float)voices_;
 	
-	return out;
-}			
\ No newline at end of file
+	// read the current mipmap level, crossfaded with the next one up
+	WavetableLookup lookup;
+	lookup.table[0][0] = bank_->table(row_, mipmapLevel_);
+	if (mipmapLevel_ + 1 < bank_->numLevels()) {
+		lookup.table[0][1] = bank_->table(row_, mipmapLevel_ + 1);
+	}
+	lookup.tableBits = bank_->tableBits();
+	lookup.levelMix = mipmapMix_;
+	voices_.template process<Interpolation>(lookup, out, frames);
+}
+
+// the interpolation policies the oscillator can be built with
+template class BasicWavetable1D<NoInterpolation>;
+template class BasicWavetable1D<LinearInterpolation>;
+template class BasicWavetable1D<HermiteInterpolation>;
+template class BasicWavetable1D<LagrangeInterpolation>;
@@ -16,40 +16,50 @@ wavetable-class: an example that implements a wavetable oscillator as a C++ clas
 #pragma once
 
 #include <vector>
+#include <memory>
+#include "WavetableBank.h"
+#include "WavetableVoices.h"
+#include "Interpolation.h"
 
-class Wavetable1D {
+// Interpolation is one of the policies in Interpolation.h
+template <class Interpolation>
+class BasicWavetable1D {
 public:
-	Wavetable1D() {}													// Default constructor
+	BasicWavetable1D() {}													// Default constructor
 	
-	Wavetable1D(float sampleRate, std::vector<float>& wave1, 			// Constructor with arguments
+	BasicWavetable1D(float sampleRate, 										// Constructor with arguments
+				std::shared_ptr<const WavetableBank> bank,
+				unsigned int row,
 				unsigned int voices,
-				std::vector<float> voicePositions,
-			    bool useInterpolation = true); 						
+				std::vector<float> voicePositions);
 				
 	void setup(float sampleRate,										// Set parameters
-			   std::vector<float>& wave1,					
+			   std::shared_ptr<const WavetableBank> bank,
+			   unsigned int row = 0,
 			   unsigned int voices = 1,
-			   std::vector<float> detuneRatios = {1.0},			   
-			   bool useInterpolation = true); 		
+			   std::vector<float> detuneRatios = {1.0});
 	
 	void setFrequency(float f);									// Set the oscillator frequency
 	float getFrequency();										// Get the oscillator frequency
 	void setDetune(float detune);								// set detune ratio
-	void setVoices(unsigned int voices);						// set number of detuned voices
-	void setDetuneRatios(std::vector<float> ratios);			// set relative detune ratio for each voice
+	void setVoices(unsigned int voices);						// set number of detuned voices (spread evenly)
+	void setDetuneRatios(const std::vector<float>& ratios);			// set relative detune ratio for each voice
 	
-	float process();				// Get the next sample and update the phase
+	float process();								// Get the next sample and update the phase
+	void processBlock(float* out, unsigned int frames);	// Fill a block of samples and update the phases
 	
-	~Wavetable1D() {}				// Destructor
+	~BasicWavetable1D() {}				// Destructor
 
 private:
-	std::vector<float> wave1_;				// Buffer holding waveform 1
-
-	float inverseSampleRate_;				// 1 divided by the audio sample rate	
-	float frequency_;						// Frequency of the oscillator
-	unsigned int voices_;					// number of voices for detuning
-	std::vector<float> readPointers_;		// Location of the read pointers (phase of oscillator)
-	float detune_;
-	std::vector<float> detuneRatios_;	// detune ratios for each voice
-	bool useInterpolation_;					// Whether to use linear interpolation
-};
\ No newline at end of file
+	std::shared_ptr<const WavetableBank> bank_;	// shared band limited tables
+	unsigned int row_;						// row of the bank to play
+
+	float sampleRate_;						// audio sample rate
+	unsigned int mipmapLevel_;				// mipmap level for the current frequency
+	float mipmapMix_;						// crossfade towards the next (duller) mipmap level
+
+	WavetableVoices voices_;				// detuned voices (phases of oscillator)
+};
+
+// the oscillator as used by the synth
+typedef BasicWavetable1D<LinearInterpolation> Wavetable1D;
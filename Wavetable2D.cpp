@@ -14,136 +14,201 @@ wavetable-class: an example that implements a wavetable oscillator as a C++ clas
 // adapted from wavetable.cpp
 
 #include <cmath>
+#include <stdexcept>
+#include <algorithm>
 #include "Wavetable2D.h"
 
 // Constructor taking arguments for sample rate and table data
-Wavetable2D::Wavetable2D(float sampleRate, 
-						 std::vector<float>& wave1, 
-						 std::vector<float>& wave2, 
-						 int num_tables, 
+template <class Interpolation>
+BasicWavetable2D<Interpolation>::BasicWavetable2D(float sampleRate, 
+						 std::shared_ptr<const WavetableBank> bank, 
 						 unsigned int voices,
-						 std::vector<float> detuneRatios,						 
-						 bool useInterpolation) 
+						 std::vector<float> detuneRatios) 
 {
-	setup(sampleRate, wave1, wave2, num_tables, voices, detuneRatios, useInterpolation);
+	setup(sampleRate, bank, voices, detuneRatios);
 } 
 
-void Wavetable2D::setup(float sampleRate, 
-						std::vector<float>& wave1, 
-						std::vector<float>& wave2, 
-						int num_tables, 
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setup(float sampleRate, 
+						std::shared_ptr<const WavetableBank> bank, 
 						unsigned int voices,
-						std::vector<float> detuneRatios,		
-						bool useInterpolation)
+						std::vector<float> detuneRatios)
 {
-	// It's faster to multiply than to divide on most platforms, so we save the inverse
-	// of the sample rate for use in the phase calculation later
-	inverseSampleRate_ = 1.0 / sampleRate;
-
-	// Copy other parameters
-	wave1_ = wave1;
-	wave2_ = wave2;
-	useInterpolation_ = useInterpolation;
-	
-	// build 2D Wavetable
-	table_.resize(num_tables);
-	for (unsigned int n = 0; n < table_.size(); n++) {
-		table_[n].resize(wave1_.size());
-		float mix = (float)n / (float)(table_.size() - 1);
-		for (unsigned int i = 0; i < wave1_.size(); i++) {
-			table_[n][i] = (1 - mix) * wave1_[i] + mix * wave2_[i];
-		} 
+	if (!bank) {
+		throw std::invalid_argument("Invalid argument to 'setup': bank");
 	}
 	
-	// set up voices
-	voices_ = voices;
+	// Keep a reference to the shared tables
+	bank_ = bank;
 	
-	// Initialise the starting state
-	readPointers_.resize(voices);
-	for (unsigned int i = 0; i < voices; i++) {
-		readPointers_[i] = 0;
-	}
-
-	detuneRatios_ = detuneRatios;
+	sampleRate_ = sampleRate;
+	
+	mipmapLevel_ = 0;
+	mipmapMix_ = 0;
+	
+	morph_ = 0;
+	morphTarget_ = 0;
 	
+	// set up voices
+	voices_.setup(sampleRate, voices, detuneRatios);
 }
 
 // Set the oscillator frequency
-void Wavetable2D::setFrequency(float f) 
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setFrequency(float f) 
 {
-	frequency_ = f;
+	voices_.setFrequency(f);
+	
+	if (bank_) {
+		bank_->mipmapPosition(f, sampleRate_, mipmapLevel_, mipmapMix_);
+	}
 }
 
 // Get the oscillator frequency
-float Wavetable2D::getFrequency() 
+template <class Interpolation>
+float BasicWavetable2D<Interpolation>::getFrequency() 
 {
-	return frequency_;
+	return voices_.getFrequency();
 }		
 
 // set the detune ratio
-void Wavetable2D::setDetune(float detune) 
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setDetune(float detune) 
+{
+	voices_.setDetune(detune);
+}
+
+// set the width of the stereo spread of the voices
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setStereoWidth(float width) 
+{
+	voices_.setStereoWidth(width);
+}
+
+// set number of detuned voices
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setVoices(unsigned int voices) 
 {
-	detune_ = detune;
+	voices_.setVoices(voices);
 }
 
 // set the detune ratios for each voice
-void Wavetable2D::setDetuneRatios(std::vector<float> ratios) 
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setDetuneRatios(const std::vector<float>& ratios) 
 {
-	detuneRatios_ = ratios;
+	voices_.setDetuneRatios(ratios);
 }
 
 // interpolate between the two waveforms
-void Wavetable2D::setTable(float mix) {
-	tablePosition_ = (int)(table_.size() * mix);
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::setTable(float mix) {
+	if (!bank_) {
+		return;
+	}
+	// position between the first and last rows
+	mix = std::max(0.0f, std::min(1.0f, mix));
+	morphTarget_ = mix * (bank_->numRows() - 1);
 }
 	
 // Get the next sample and update the phase
-float Wavetable2D::process() {
-	float out = 0;
-	
+template <class Interpolation>
+float BasicWavetable2D<Interpolation>::process() {
+	float out;
+	processBlock(&out, 1);
+	return out;
+}
+
+// Fill a block of samples and update the phases
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::processBlock(float* out, unsigned int frames) {
+	render(out, nullptr, frames);
+}
+
+// Fill a block of stereo samples, with the detuned voices panned across the stereo field
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::processBlock(float* outLeft, float* outRight, unsigned int frames) {
+	render(outLeft, outRight, frames);
+}
+
+// render the voices for a (part of a) block, in mono when outRight is null
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::renderVoices(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames) {
+	if (outRight != nullptr) {
+		voices_.template processStereo<Interpolation>(lookup, outLeft, outRight, frames);
+	}
+	else {
+		voices_.template process<Interpolation>(lookup, outLeft, frames);
+	}
+}
+
+template <class Interpolation>
+void BasicWavetable2D<Interpolation>::render(float* outLeft, float* outRight, unsigned int frames) {
 	// Make sure we have a valid table
-	if(table_.size() == 0 || table_[tablePosition_].size() == 0)
-		return out;
+	if (!bank_) {
+		for (unsigned int n = 0; n < frames; n++) {
+			outLeft[n] = 0;
+			if (outRight != nullptr) {
+				outRight[n] = 0;
+			}
+		}
+		return;
+	}
 	
-	// Increment and wrap the phase
-	for (unsigned int i = 0; i < voices_; i++) {
-		float frequency = frequency_ * (1.0 + detuneRatios_[i] * detune_);
-		readPointers_[i] += table_[tablePosition_].size() * frequency * inverseSampleRate_;
-		while (readPointers_[i] >= table_[tablePosition_].size())
-			readPointers_[i] -= table_[tablePosition_].size();
+	WavetableLookup lookup;
+	lookup.tableBits = bank_->tableBits();
+	lookup.levelMix = mipmapMix_;
+	
+	// only one row to read
+	if (bank_->numRows() < 2) {
+		lookup.table[0][0] = bank_->table(0, mipmapLevel_);
+		if (mipmapLevel_ + 1 < bank_->numLevels()) {
+			lookup.table[0][1] = bank_->table(0, mipmapLevel_ + 1);
+		}
+		renderVoices(lookup, outLeft, outRight, frames);
+		return;
 	}
 	
-	if(useInterpolation_) {
-		for (unsigned int i = 0; i < voices_; i++) {
-			// The pointer will take a fractional index. Look for the sample on
-			// either side which are indices we can actually read into the buffer.
-			// If we get to the end of the buffer, wrap around to 0.
-			int indexBelow = floorf(readPointers_[i]);
-			int indexAbove = indexBelow + 1;
-			if(indexAbove >= table_[tablePosition_].size())
-				indexAbove = 0;
-		
-			// For linear interpolation, we need to decide how much to weigh each
-			// sample. The closer the fractional part of the index is to 0, the
-			// more weight we give to the "below" sample. The closer the fractional
-			// part is to 1, the more weight we give to the "above" sample.
-			float fractionAbove = readPointers_[i] - indexBelow;
-			float fractionBelow = 1.0 - fractionAbove;
+	// Ramp the morph towards its target across the block, interpolating between the two
+	// rows either side of it. The block is split wherever the ramp crosses into another
+	// pair of rows, so banks with only the two source rows never need splitting
+	const unsigned int lastPair = bank_->numRows() - 2;
+	const float step = (morphTarget_ - morph_) / frames;
+	float position = morph_;
+	unsigned int done = 0;
+	
+	while (done < frames) {
+		// pair of rows holding the next sample (moving down, a position on a row belongs to the pair below it)
+		float next = position + step;
+		float below = step < 0 ? ceilf(next) - 1 : floorf(next);
+		unsigned int row = (unsigned int)std::max(0.0f, std::min((float)lastPair, below));
 		
-			// Calculate the weighted average of the "below" and "above" samples
-		    out += fractionBelow * table_[tablePosition_][indexBelow] +
-		    	   fractionAbove * table_[tablePosition_][indexAbove];
+		// stop where the ramp leaves this pair
+		unsigned int count = frames - done;
+		float end = position + step * count;
+		if (end > row + 1 || end < row) {
+			float edge = end > row + 1 ? row + 1 : row;
+			count = std::max(1u, std::min(count, (unsigned int)((edge - position) / step)));
+			end = position + step * count;
 		}
-	}
-	else {
-		for (unsigned int i = 0; i < voices_; i++) {
-			// Read the table without interpolation
-			out += table_[tablePosition_][(int)readPointers_[i]];
+		
+		// read the current mipmap level of both rows, crossfaded with the next one up
+		for (unsigned int i = 0; i < 2; i++) {
+			lookup.table[i][0] = bank_->table(row + i, mipmapLevel_);
+			lookup.table[i][1] = mipmapLevel_ + 1 < bank_->numLevels() ? bank_->table(row + i, mipmapLevel_ + 1) : nullptr;
 		}
+		lookup.morphStart = position - row;
+		lookup.morphEnd = end - row;
+		renderVoices(lookup, outLeft + done, outRight != nullptr ? outRight + done : nullptr, count);
+		
+		position = end;
+		done += count;
 	}
 	
-	// reduce amplitude to compensate for multiple voices
-	out /= (float)voices_;
-	
-	return out;
-}			
\ No newline at end of file
+	morph_ = morphTarget_;
+}
+
+// the interpolation policies the oscillator can be built with
+template class BasicWavetable2D<NoInterpolation>;
+template class BasicWavetable2D<LinearInterpolation>;
+template class BasicWavetable2D<HermiteInterpolation>;
+template class BasicWavetable2D<LagrangeInterpolation>;
@@ -16,50 +16,57 @@ wavetable-class: an example that implements a wavetable oscillator as a C++ clas
 #pragma once
 
 #include <vector>
+#include <memory>
+#include "WavetableBank.h"
+#include "WavetableVoices.h"
+#include "Interpolation.h"
 
-class Wavetable2D {
+// Interpolation is one of the policies in Interpolation.h
+template <class Interpolation>
+class BasicWavetable2D {
 public:
-	Wavetable2D() {}													// Default constructor
+	BasicWavetable2D() {}													// Default constructor
 	
-	Wavetable2D(float sampleRate, std::vector<float>& wave1, 			// Constructor with arguments
-				std::vector<float>& wave2,
-				int num_tables,
+	BasicWavetable2D(float sampleRate, 										// Constructor with arguments
+				std::shared_ptr<const WavetableBank> bank,
 				unsigned int voices,
-				std::vector<float> voicePositions,
-			    bool useInterpolation = true); 						
+				std::vector<float> voicePositions);
 				
 	void setup(float sampleRate,										// Set parameters
-			   std::vector<float>& wave1,					
-			   std::vector<float>& wave2,
-			   int num_tables,
+			   std::shared_ptr<const WavetableBank> bank,
 			   unsigned int voices = 1,
-			   std::vector<float> detuneRatios = {1.0},			   
-			   bool useInterpolation = true); 		
+			   std::vector<float> detuneRatios = {1.0});
 	
 	void setFrequency(float f);									// Set the oscillator frequency
 	float getFrequency();										// Get the oscillator frequency
 	void setDetune(float detune);								// set detune ratio
-	void setVoices(unsigned int voices);						// set number of detuned voices
-	void setDetuneRatios(std::vector<float> ratios);		// set relative detune ratio for each voice
+	void setVoices(unsigned int voices);						// set number of detuned voices (spread evenly)
+	void setDetuneRatios(const std::vector<float>& ratios);		// set relative detune ratio for each voice
+	void setStereoWidth(float width);							// pan voices by detune position (0 = mono, 1 = full width)
 	
-	void setTable(float mix);		// set the mix between the two waveforms
+	void setTable(float mix);		// set the mix between the two waveforms (reached by the end of the next block)
 	
-	float process();				// Get the next sample and update the phase
+	float process();								// Get the next sample and update the phase
+	void processBlock(float* out, unsigned int frames);	// Fill a block of samples and update the phases
+	void processBlock(float* outLeft, float* outRight, unsigned int frames);	// Fill a block of stereo samples
 	
-	~Wavetable2D() {}				// Destructor
+	~BasicWavetable2D() {}				// Destructor
 
 private:
-	std::vector<float> wave1_;				// Buffer holding waveform 1
-	std::vector<float> wave2_;				// Buffer holding waveform 2
-	std::vector<std::vector<float>> table_;	// Buffer holding the full 2D wavetable
+	void render(float* outLeft, float* outRight, unsigned int frames);		// mono when outRight is null
+	void renderVoices(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames);
+
+	std::shared_ptr<const WavetableBank> bank_;	// shared band limited 2D wavetable
+	
+	float morph_;							// Current position in the 2D table, in rows
+	float morphTarget_;						// position to ramp to over the next block
 	
-	unsigned int tablePosition_;			// Current position in the 2D table
+	float sampleRate_;						// audio sample rate
+	unsigned int mipmapLevel_;				// mipmap level for the current frequency
+	float mipmapMix_;						// crossfade towards the next (duller) mipmap level
+
+	WavetableVoices voices_;				// detuned voices (phases of oscillator)
+};
 
-	float inverseSampleRate_;				// 1 divided by the audio sample rate	
-	float frequency_;						// Frequency of the oscillator
-	unsigned int voices_;					// number of voices for detuning
-	std::vector<float> readPointers_;		// Location of the read pointer (phase of oscillator)
-	float detune_;
-	std::vector<float> detuneRatios_;	// detune ratios for each voice
-	bool useInterpolation_;					// Whether to use linear interpolation
-};
\ No newline at end of file
+// the oscillator as used by the synth
+typedef BasicWavetable2D<LinearInterpolation> Wavetable2D;
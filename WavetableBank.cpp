@@ -0,0 +1,143 @@
+/***** WavetableBank.cpp *****/
+
+#include "WavetableBank.h"
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <cmath>
+#include <stdlib.h>
+#include <stdexcept>
+#include <algorithm>
+
+// alignment of the table block (one cache line)
+static const size_t kAlignment = 64;
+
+// Band limit a single-cycle waveform once per octave. Level L keeps the harmonics up to
+// (size / 2) >> L, so it is free of aliasing for fundamentals up to sampleRate / (size >> L)
+static std::vector<std::vector<float>> buildMipmap(const float* wave, unsigned int size, unsigned int levels)
+{
+	unsigned int harmonics = size / 2;			// the Nyquist bin is left out
+
+	// cosine and sine at every table position
+	std::vector<double> cosTable(size);
+	std::vector<double> sinTable(size);
+	for (unsigned int n = 0; n < size; n++) {
+		cosTable[n] = cos(2.0 * M_PI * n / size);
+		sinTable[n] = sin(2.0 * M_PI * n / size);
+	}
+
+	// Fourier series of the waveform
+	std::vector<double> cosCoeffs(harmonics, 0);
+	std::vector<double> sinCoeffs(harmonics, 0);
+	for (unsigned int h = 0; h < harmonics; h++) {
+		for (unsigned int n = 0; n < size; n++) {
+			cosCoeffs[h] += wave[n] * cosTable[(h * n) % size];
+			sinCoeffs[h] += wave[n] * sinTable[(h * n) % size];
+		}
+	}
+
+	// resynthesise each level from its share of the harmonics
+	std::vector<std::vector<float>> mipmap(levels, std::vector<float>(size));
+	for (unsigned int level = 0; level < levels; level++) {
+		unsigned int maxHarmonic = std::min(harmonics - 1, harmonics >> level);
+		for (unsigned int n = 0; n < size; n++) {
+			double sample = cosCoeffs[0];
+			for (unsigned int h = 1; h <= maxHarmonic; h++) {
+				sample += 2.0 * (cosCoeffs[h] * cosTable[(h * n) % size] + sinCoeffs[h] * sinTable[(h * n) % size]);
+			}
+			mipmap[level][n] = sample / size;
+		}
+	}
+
+	return mipmap;
+}
+
+std::shared_ptr<const WavetableBank> WavetableBank::create(const float* wave1,
+														   const float* wave2,
+														   unsigned int size,
+														   unsigned int numRows)
+{
+	return std::shared_ptr<const WavetableBank>(new WavetableBank(wave1, wave2, size, numRows));
+}
+
+std::shared_ptr<const WavetableBank> WavetableBank::create(const float* wave, unsigned int size)
+{
+	return std::shared_ptr<const WavetableBank>(new WavetableBank(wave, wave, size, 1));
+}
+
+WavetableBank::WavetableBank(const float* wave1, const float* wave2, unsigned int size, unsigned int numRows)
+	: numRows_(numRows), data_(nullptr)
+{
+	if (wave1 == nullptr || wave2 == nullptr) {
+		throw std::invalid_argument("Invalid argument to 'WavetableBank': wave");
+	}
+	// the oscillators' fixed point phase needs a power of two table length
+	tableBits_ = 0;
+	while ((1u << tableBits_) < size) {
+		tableBits_++;
+	}
+	if (size < 2 || (1u << tableBits_) != size) {
+		throw std::invalid_argument("Invalid argument to 'WavetableBank': size must be a power of two");
+	}
+	if (numRows == 0) {
+		throw std::invalid_argument("Invalid argument to 'WavetableBank': numRows");
+	}
+
+	// one level per octave, down to a single harmonic
+	numLevels_ = tableBits_;
+
+	if (posix_memalign((void**)&data_, kAlignment, sizeof(float) * numRows_ * numLevels_ * size) != 0) {
+		throw std::bad_alloc();
+	}
+
+	// band limit both waveforms
+	std::vector<std::vector<float>> mipmap1 = buildMipmap(wave1, size, numLevels_);
+	std::vector<std::vector<float>> mipmap2 = buildMipmap(wave2, size, numLevels_);
+
+	// build the rows (the mix is linear, so each level can be mixed from the band limited waves)
+	for (unsigned int row = 0; row < numRows_; row++) {
+		float mix = numRows_ > 1 ? (float)row / (float)(numRows_ - 1) : 0;
+		for (unsigned int level = 0; level < numLevels_; level++) {
+			float* dest = data_ + ((size_t)row * numLevels_ + level) * size;
+			for (unsigned int i = 0; i < size; i++) {
+				dest[i] = (1 - mix) * mipmap1[level][i] + mix * mipmap2[level][i];
+			}
+		}
+	}
+}
+
+WavetableBank::~WavetableBank()
+{
+	free(data_);
+}
+
+unsigned int WavetableBank::numRows() const {return numRows_; }
+unsigned int WavetableBank::numLevels() const {return numLevels_; }
+unsigned int WavetableBank::tableBits() const {return tableBits_; }
+unsigned int WavetableBank::tableSize() const {return 1u << tableBits_; }
+
+const float* WavetableBank::table(unsigned int row, unsigned int level) const
+{
+	return data_ + ((size_t)row * numLevels_ + level) * tableSize();
+}
+
+void WavetableBank::mipmapPosition(float frequency, float sampleRate, unsigned int& level, float& mix) const
+{
+	// position of the frequency in octaves relative to the mipmap levels: level L is alias
+	// free up to octave L + 1, so crossfading from L to L + 1 across the octave keeps both
+	// levels below Nyquist without any step in brightness
+	float octave = log2f(2.0 * fabsf(frequency) * tableSize() / sampleRate);
+	if (octave <= 0) {
+		level = 0;
+		mix = 0;
+	}
+	else {
+		level = (unsigned int)octave;
+		mix = octave - level;
+		if (level >= numLevels_ - 1) {
+			level = numLevels_ - 1;
+			mix = 0;
+		}
+	}
+}
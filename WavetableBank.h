@@ -0,0 +1,53 @@
+/***** WavetableBank.h *****/
+
+/*
+Immutable set of band limited wavetables shared between oscillators.
+Row r is a linear mix from the first source wave (row 0) to the second (last row),
+and every row is band limited once per octave (mipmap level L keeps the harmonics
+up to (size / 2) >> L). All tables live in one contiguous, cache-line aligned block,
+indexed as [row][mipmap level][sample].
+
+Banks are only handed out through shared pointers to const, so any number of
+oscillators can read the same tables without copying them.
+*/
+
+#pragma once
+
+#include <memory>
+
+class WavetableBank {
+public:
+	// build numRows mixes between wave1 and wave2 (both size samples long, a power of two)
+	static std::shared_ptr<const WavetableBank> create(const float* wave1,
+													   const float* wave2,
+													   unsigned int size,
+													   unsigned int numRows);
+	// build a bank holding a single wave
+	static std::shared_ptr<const WavetableBank> create(const float* wave, unsigned int size);
+
+	unsigned int numRows() const;			// number of mixes between the source waves
+	unsigned int numLevels() const;			// number of mipmap levels per row
+	unsigned int tableBits() const;			// log2 of the table length
+	unsigned int tableSize() const;			// table length in samples
+
+	// start of the table for one row and mipmap level
+	const float* table(unsigned int row, unsigned int level) const;
+
+	// pick the mipmap level for a frequency, and the crossfade towards the next level up
+	void mipmapPosition(float frequency, float sampleRate, unsigned int& level, float& mix) const;
+
+	~WavetableBank();
+
+private:
+	WavetableBank(const float* wave1, const float* wave2, unsigned int size, unsigned int numRows);
+
+	// banks are shared, never copied
+	WavetableBank(const WavetableBank&) = delete;
+	WavetableBank& operator=(const WavetableBank&) = delete;
+
+	unsigned int numRows_;
+	unsigned int numLevels_;
+	unsigned int tableBits_;
+
+	float* data_;					// numRows_ * numLevels_ tables in a single aligned allocation
+};
@@ -0,0 +1,184 @@
+/***** WavetableGenerator.h *****/
+
+/*
+Compile-time generation of single-cycle waveforms.
+Every generator is constexpr, so a table assigned to a constexpr variable is computed
+by the compiler and stored in the binary as read-only data: nothing is generated at
+startup. The Fourier series shapes are band limited to the given number of harmonics.
+
+Generators stick to plain loops and arithmetic (C++14 constexpr), and sines are built
+up by recurrence, to stay well inside the compilers' constant evaluation limits.
+*/
+
+#pragma once
+
+namespace wavetable {
+
+// A single cycle of N samples that can be filled in at compile time
+template <unsigned int N>
+struct Waveform {
+	float samples[N];
+
+	constexpr float& operator[](unsigned int n) {return samples[n]; }
+	constexpr const float& operator[](unsigned int n) const {return samples[n]; }
+	constexpr unsigned int size() const {return N; }
+	const float* data() const {return samples; }
+};
+
+constexpr double kPi = 3.14159265358979323846;
+
+// sine for compile time use (Taylor series after reducing to [-pi, pi])
+constexpr double sine(double x)
+{
+	long cycles = (long)(x / (2.0 * kPi) + (x >= 0 ? 0.5 : -0.5));
+	x -= cycles * 2.0 * kPi;
+	double term = x;
+	double sum = x;
+	for (int k = 1; k < 12; k++) {
+		term *= -x * x / ((2 * k) * (2 * k + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double cosine(double x)
+{
+	return sine(x + 0.5 * kPi);
+}
+
+// scale so that the largest sample is 1
+template <unsigned int N>
+constexpr Waveform<N> normalise(Waveform<N> wave)
+{
+	float maxElem = wave[0];
+	for (unsigned int n = 1; n < N; n++) {
+		if (wave[n] > maxElem) {
+			maxElem = wave[n];
+		}
+	}
+	for (unsigned int n = 0; n < N; n++) {
+		wave[n] /= maxElem;
+	}
+	return wave;
+}
+
+// Sum of sine harmonics: harmonic k + 1 has amplitude amplitudes[k].
+// Peak normalised when normalised is true
+template <unsigned int N, unsigned int H>
+constexpr Waveform<N> additive(const double (&amplitudes)[H], bool normalised = true)
+{
+	Waveform<N> wave {};
+	for (unsigned int n = 0; n < N; n++) {
+		double x = 2.0 * kPi * n / N;
+		double twoCos = 2.0 * cosine(x);
+		// sin((k + 1)x) = 2 cos(x) sin(kx) - sin((k - 1)x)
+		double sinPrevious = 0;
+		double sinCurrent = sine(x);
+		double sample = 0;
+		for (unsigned int k = 0; k < H; k++) {
+			sample += amplitudes[k] * sinCurrent;
+			double sinNext = twoCos * sinCurrent - sinPrevious;
+			sinPrevious = sinCurrent;
+			sinCurrent = sinNext;
+		}
+		wave[n] = sample;
+	}
+	return normalised ? normalise(wave) : wave;
+}
+
+// Harmonic amplitudes of the common shapes, as used by additive()
+template <unsigned int H>
+struct Harmonics {
+	double amplitudes[H];
+};
+
+template <unsigned int H>
+constexpr Harmonics<H> sawHarmonics()
+{
+	Harmonics<H> h {};
+	for (unsigned int k = 0; k < H; k++) {
+		h.amplitudes[k] = (k % 2 == 0 ? 1.0 : -1.0) / (k + 1);
+	}
+	return h;
+}
+
+template <unsigned int H>
+constexpr Harmonics<H> squareHarmonics()
+{
+	Harmonics<H> h {};
+	for (unsigned int k = 0; k < H; k += 2) {
+		h.amplitudes[k] = 1.0 / (k + 1);
+	}
+	return h;
+}
+
+template <unsigned int H>
+constexpr Harmonics<H> triangleHarmonics()
+{
+	Harmonics<H> h {};
+	for (unsigned int k = 0; k < H; k += 2) {
+		h.amplitudes[k] = (k % 4 == 0 ? 1.0 : -1.0) / ((k + 1) * (k + 1));
+	}
+	return h;
+}
+
+// Band limited saw, square and triangle with H harmonics
+template <unsigned int N, unsigned int H>
+constexpr Waveform<N> fourierSaw()
+{
+	return additive<N>(sawHarmonics<H>().amplitudes);
+}
+
+template <unsigned int N, unsigned int H>
+constexpr Waveform<N> fourierSquare()
+{
+	return additive<N>(squareHarmonics<H>().amplitudes);
+}
+
+template <unsigned int N, unsigned int H>
+constexpr Waveform<N> fourierTriangle()
+{
+	return additive<N>(triangleHarmonics<H>().amplitudes);
+}
+
+template <unsigned int N>
+constexpr Waveform<N> sineWave()
+{
+	const double fundamental[1] = {1.0};
+	return additive<N>(fundamental);
+}
+
+// Saw made by differentiating a parabola with the filter H(z) = (1 - z^-2) / 2,
+// sample for sample the same as the table render.cpp used to build in setup()
+// (including its treatment of the first two samples)
+template <unsigned int N>
+constexpr Waveform<N> parabolicSaw()
+{
+	// populate buffer with basic waveform
+	Waveform<N> parabola {};
+	for (unsigned int n = 0; n < N; n++) {
+		float x = 2.0 * (float)n / (float)N - 1;
+		parabola[n] = x * x;
+	}
+	// apply filter [H(z) = (1 - Z^-2) / 2]
+	Waveform<N> saw {};
+	saw[0] = parabola[0] - parabola[N - 1];
+	saw[1] = parabola[1] - parabola[N - 1];
+	for (unsigned int n = 2; n < N; n++) {
+		saw[n] = (parabola[n] - parabola[n - 2]) / 2.0;
+	}
+	return normalise(saw);
+}
+
+// Square made by subtracting a copy of the saw shifted by half a cycle
+template <unsigned int N>
+constexpr Waveform<N> shiftedDifference(const Waveform<N>& saw)
+{
+	Waveform<N> square {};
+	for (unsigned int n = 0; n < N; n++) {
+		square[n] = saw[n] - saw[(n + N / 2) % N];
+	}
+	return normalise(square);
+}
+
+} // namespace wavetable
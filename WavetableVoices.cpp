@@ -0,0 +1,204 @@
+/***** WavetableVoices.cpp *****/
+
+#include "WavetableVoices.h"
+
+#include <vector>
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include "Simd.h"
+#include "Interpolation.h"
+
+const unsigned int WavetableVoices::kMaxVoices;
+
+void WavetableVoices::setup(float sampleRate, unsigned int voices, const std::vector<float>& detuneRatios)
+{
+	// It's faster to multiply than to divide on most platforms, so we save the inverse
+	// of the sample rate for use in the phase calculation later
+	inverseSampleRate_ = 1.0 / sampleRate;
+
+	frequency_ = 0;
+	detune_ = 0;
+	stereoWidth_ = 1;
+
+	// Initialise the starting state
+	phases_.fill(0);
+	increments_.fill(0);
+
+	voices_ = std::max(1u, std::min(kMaxVoices, voices));
+	setDetuneRatios(detuneRatios);
+}
+
+// Set the centre frequency
+void WavetableVoices::setFrequency(float f)
+{
+	frequency_ = f;
+	updateIncrements();
+}
+
+// Get the centre frequency
+float WavetableVoices::getFrequency()
+{
+	return frequency_;
+}
+
+// set the detune ratio
+void WavetableVoices::setDetune(float detune)
+{
+	detune_ = detune;
+	updateIncrements();
+}
+
+// set the number of voices, spreading their detune ratios evenly from -1 to 1
+void WavetableVoices::setVoices(unsigned int voices)
+{
+	voices_ = std::max(1u, std::min(kMaxVoices, voices));
+	for (unsigned int i = 0; i < kMaxVoices; i++) {
+		detuneRatios_[i] = i < voices_ && voices_ > 1 ? -1.0 + 2.0 * i / (voices_ - 1) : 0;
+	}
+	updateIncrements();
+	updatePans();
+}
+
+// get the number of voices
+unsigned int WavetableVoices::getVoices()
+{
+	return voices_;
+}
+
+// set the detune ratios for each voice (missing ratios are 0)
+void WavetableVoices::setDetuneRatios(const std::vector<float>& ratios)
+{
+	for (unsigned int i = 0; i < kMaxVoices; i++) {
+		detuneRatios_[i] = i < ratios.size() ? ratios[i] : 0;
+	}
+	updateIncrements();
+	updatePans();
+}
+
+// scale the pan positions
+void WavetableVoices::setStereoWidth(float width)
+{
+	stereoWidth_ = width;
+	updatePans();
+}
+
+// the increments only change with the controls, so they are cached here rather than per sample
+void WavetableVoices::updateIncrements()
+{
+	for (unsigned int i = 0; i < voices_; i++) {
+		double frequency = frequency_ * (1.0 + detuneRatios_[i] * detune_);
+		// cycles per sample scaled to 2^32, reduced modulo 2^32
+		increments_[i] = (uint32_t)llrint(frequency * inverseSampleRate_ * 4294967296.0);
+	}
+}
+
+// gain of each voice, and its equal-power pan from its detune position
+void WavetableVoices::updatePans()
+{
+	for (unsigned int i = 0; i < kMaxVoices; i++) {
+		// reduce amplitude to compensate for multiple voices, silence the unused voices
+		gains_[i] = i < voices_ ? 1.0 / (float)voices_ : 0;
+		float position = std::max(-1.0f, std::min(1.0f, detuneRatios_[i] * stereoWidth_));
+		float angle = (position + 1) * 0.25 * M_PI;
+		gainsLeft_[i] = gains_[i] * cosf(angle);
+		gainsRight_[i] = gains_[i] * sinf(angle);
+	}
+}
+
+// read one row of the lookup, crossfading between its two mipmap levels
+template <class Interpolation>
+static inline simd::float4 readRow(const float* const* levels, simd::float4 levelMix,
+								   const uint32_t* indexBelow, uint32_t indexMask,
+								   simd::float4 fractionAbove)
+{
+	simd::float4 value = Interpolation::read(levels[0], indexBelow, indexMask, fractionAbove);
+	if (levels[1] != nullptr) {
+		simd::float4 valueAbove = Interpolation::read(levels[1], indexBelow, indexMask, fractionAbove);
+		value = value + levelMix * (valueAbove - value);
+	}
+	return value;
+}
+
+template <class Interpolation>
+void WavetableVoices::process(const WavetableLookup& lookup, float* out, unsigned int frames)
+{
+	render<Interpolation, false>(lookup, out, nullptr, frames);
+}
+
+template <class Interpolation>
+void WavetableVoices::processStereo(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames)
+{
+	render<Interpolation, true>(lookup, outLeft, outRight, frames);
+}
+
+template <class Interpolation, bool kStereo>
+void WavetableVoices::render(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames)
+{
+	for (unsigned int n = 0; n < frames; n++) {
+		outLeft[n] = 0;
+		if (kStereo) {
+			outRight[n] = 0;
+		}
+	}
+	
+	// Make sure we have a valid table
+	const unsigned int tableBits = lookup.tableBits;
+	if (lookup.table[0][0] == nullptr || tableBits == 0 || frames == 0) {
+		return;
+	}
+	
+	// skip the reads that would not be heard
+	const float* rowA[2] = {lookup.table[0][0], lookup.levelMix > 0 ? lookup.table[0][1] : nullptr};
+	const float* rowB[2] = {lookup.table[1][0], lookup.levelMix > 0 ? lookup.table[1][1] : nullptr};
+	const bool morphing = rowB[0] != nullptr && (lookup.morphStart > 0 || lookup.morphEnd > 0);
+	
+	// the top tableBits of the phase are the table index, the rest the fraction
+	const unsigned int indexShift = 32 - tableBits;
+	const uint32_t indexMask = (1u << tableBits) - 1;
+	const simd::uint4 fractionMask = simd::uint4::set1((1u << indexShift) - 1);
+	const simd::float4 fractionScale = simd::float4::set1(1.0 / (double)(1u << indexShift));
+	const simd::float4 levelMix = simd::float4::set1(lookup.levelMix);
+	const float morphStep = (lookup.morphEnd - lookup.morphStart) / frames;
+	
+	// each group of 4 voices keeps its phases in registers for the whole block
+	for (unsigned int v = 0; v < voices_; v += simd::kLanes) {
+		simd::uint4 phase = simd::uint4::load(&phases_[v]);
+		simd::uint4 increment = simd::uint4::load(&increments_[v]);
+		simd::float4 gain = simd::float4::load(kStereo ? &gainsLeft_[v] : &gains_[v]);
+		simd::float4 gainRight = simd::float4::load(kStereo ? &gainsRight_[v] : &gains_[v]);
+		
+		uint32_t indexBelow[simd::kLanes];
+		
+		for (unsigned int n = 0; n < frames; n++) {
+			// Increment the phase (wraps around at the end of the cycle)
+			phase = phase + increment;
+			(phase >> indexShift).store(indexBelow);
+			simd::float4 fractionAbove = simd::toFloat(phase & fractionMask) * fractionScale;
+			
+			simd::float4 value = readRow<Interpolation>(rowA, levelMix, indexBelow, indexMask, fractionAbove);
+			if (morphing) {
+				simd::float4 valueB = readRow<Interpolation>(rowB, levelMix, indexBelow, indexMask, fractionAbove);
+				simd::float4 morph = simd::float4::set1(lookup.morphStart + (n + 1) * morphStep);
+				value = value + morph * (valueB - value);
+			}
+			
+			outLeft[n] += simd::sum(value * gain);
+			if (kStereo) {
+				outRight[n] += simd::sum(value * gainRight);
+			}
+		}
+		
+		phase.store(&phases_[v]);
+	}
+}
+
+// the interpolation policies the oscillators can be built with
+template void WavetableVoices::process<NoInterpolation>(const WavetableLookup&, float*, unsigned int);
+template void WavetableVoices::process<LinearInterpolation>(const WavetableLookup&, float*, unsigned int);
+template void WavetableVoices::process<HermiteInterpolation>(const WavetableLookup&, float*, unsigned int);
+template void WavetableVoices::process<LagrangeInterpolation>(const WavetableLookup&, float*, unsigned int);
+template void WavetableVoices::processStereo<NoInterpolation>(const WavetableLookup&, float*, float*, unsigned int);
+template void WavetableVoices::processStereo<LinearInterpolation>(const WavetableLookup&, float*, float*, unsigned int);
+template void WavetableVoices::processStereo<HermiteInterpolation>(const WavetableLookup&, float*, float*, unsigned int);
+template void WavetableVoices::processStereo<LagrangeInterpolation>(const WavetableLookup&, float*, float*, unsigned int);
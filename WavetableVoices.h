@@ -0,0 +1,86 @@
+/***** WavetableVoices.h *****/
+
+/*
+Bank of detuned unison voices shared by Wavetable1D and Wavetable2D.
+Phases, phase increments and gains are held as separate arrays (structure of arrays),
+so that each group of 4 voices is advanced and read from the table together. The
+arrays have a fixed capacity of kMaxVoices, so changing the number of voices or their
+detune ratios never allocates and is safe on the audio thread.
+
+Each voice is also panned by its detune position (-1 = left, 1 = right) for stereo
+rendering, with equal-power gains so the voices keep their level wherever they sit.
+
+Phases are 32-bit fixed point (one cycle = 2^32), so wrapping is free and tuning is
+exact however long the oscillator runs. Tables must be a power of two long: the top
+bits of the phase give the table index and the remaining bits the fraction.
+*/
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <stdint.h>
+
+// Up to four tables read at the same phase and blended together: two adjacent rows
+// of a 2D wavetable (morphed), each at two neighbouring mipmap levels (crossfaded)
+struct WavetableLookup {
+	const float* table[2][2] = {{nullptr, nullptr}, {nullptr, nullptr}};	// [row][mipmap level], only [0][0] is required
+	unsigned int tableBits = 0;		// log2 of the table length
+	float levelMix = 0;				// crossfade towards the second mipmap level
+	float morphStart = 0;			// crossfade towards the second row before the block
+	float morphEnd = 0;				// crossfade towards the second row at the end of the block
+};
+
+class WavetableVoices {
+public:
+	static const unsigned int kMaxVoices = 16;					// capacity (a multiple of simd::kLanes)
+
+	WavetableVoices() {}											// Default constructor
+
+	void setup(float sampleRate,									// Set parameters
+			   unsigned int voices,
+			   const std::vector<float>& detuneRatios);
+
+	void setFrequency(float f);									// Set the centre frequency
+	float getFrequency();										// Get the centre frequency
+	void setDetune(float detune);								// set detune ratio
+	void setVoices(unsigned int voices);						// set number of voices, spread evenly
+	unsigned int getVoices();									// get number of voices
+	void setDetuneRatios(const std::vector<float>& ratios);		// set relative detune ratio for each voice
+
+	void setStereoWidth(float width);							// scale the pan positions (0 = mono, 1 = full width)
+
+	// Render a block of the summed voices from single-cycle tables of 2^tableBits samples,
+	// updating the phases. The morph between rows is ramped linearly across the block.
+	// Interpolation is one of the policies in Interpolation.h
+	template <class Interpolation>
+	void process(const WavetableLookup& lookup, float* out, unsigned int frames);
+
+	// As process(), with each voice panned by its detune position
+	template <class Interpolation>
+	void processStereo(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames);
+
+	~WavetableVoices() {}										// Destructor
+
+private:
+	void updateIncrements();			// recalculate the per-voice phase increments
+	void updatePans();					// recalculate the per-voice stereo gains
+
+	// shared kernel of process() and processStereo()
+	template <class Interpolation, bool kStereo>
+	void render(const WavetableLookup& lookup, float* outLeft, float* outRight, unsigned int frames);
+
+	double inverseSampleRate_;			// 1 divided by the audio sample rate
+	float frequency_;					// Centre frequency of the voices
+	float detune_;						// detune amount
+	float stereoWidth_;					// scaling of the pan positions
+	unsigned int voices_;				// number of active voices
+
+	// one entry per voice, unused entries have zero gain
+	std::array<float, kMaxVoices> detuneRatios_;				// detune ratios for each voice
+	alignas(16) std::array<uint32_t, kMaxVoices> phases_;		// fixed point phase of each voice
+	alignas(16) std::array<uint32_t, kMaxVoices> increments_;	// phase increment per sample of each voice
+	alignas(16) std::array<float, kMaxVoices> gains_;			// output gain of each voice
+	alignas(16) std::array<float, kMaxVoices> gainsLeft_;		// left channel gain of each voice
+	alignas(16) std::array<float, kMaxVoices> gainsRight_;		// right channel gain of each voice
+};
@@ -0,0 +1,10 @@
+/***** Wavetables.cpp *****/
+
+#include "Wavetables.h"
+
+// constexpr makes the compiler generate the tables (and fail the build if it cannot)
+static constexpr wavetable::Waveform<kWavetableSize> kSawGenerated = wavetable::parabolicSaw<kWavetableSize>();
+static constexpr wavetable::Waveform<kWavetableSize> kSquareGenerated = wavetable::shiftedDifference(kSawGenerated);
+
+const wavetable::Waveform<kWavetableSize> kSawWavetable = kSawGenerated;
+const wavetable::Waveform<kWavetableSize> kSquareWavetable = kSquareGenerated;
@@ -0,0 +1,15 @@
+/***** Wavetables.h *****/
+
+/*
+Source waveforms for the oscillators, generated at compile time (see WavetableGenerator.h)
+and stored in the binary as read-only data
+*/
+
+#pragma once
+
+#include "WavetableGenerator.h"
+
+const unsigned int kWavetableSize = 512;		// samples per cycle (must be a power of two)
+
+extern const wavetable::Waveform<kWavetableSize> kSawWavetable;		// differentiated parabola
+extern const wavetable::Waveform<kWavetableSize> kSquareWavetable;	// saw minus the saw half a cycle later
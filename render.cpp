@@ -13,19 +13,31 @@ Tolly Collins
 #include <cmath>
 #include <algorithm>
 #include <utility>
+#include <memory>
+#include "Wavetables.h"
+#include "WavetableBank.h"
 #include "Wavetable1D.h"
 #include "Wavetable2D.h"
+#include "VoiceAllocator.h"
 #include "ADSR.h"
-#include "MoogFilter.h"
+#include "ControlRate.h"
+#include "MoogFilterBank.h"
+#include "FastMath.h"
+#include "Denormals.h"
 #include "ProbabilisticArp.h"
+#include "ArpLookahead.h"
+#include "SeedBank.h"
 #include "MonoFilePlayer.h"
 #include "MIDILooper.h"
 
 
 // global constants and variables
 // oscillators
-const unsigned int kWavetableSize = 512;
-const unsigned int kWavetable2DSize = 128;
+// rows in the 2D wavetables - the oscillators morph continuously between adjacent rows
+// and the rows are linear mixes, so the two source waves are all that is needed
+const unsigned int kWavetable2DSize = 2;
+// band limited saw-to-square tables shared by all the oscillators
+std::shared_ptr<const WavetableBank> gWavetableBank;
 
 unsigned int gBassDetuneVoices = 3;
 Wavetable2D gBassOsc;
@@ -41,7 +53,8 @@ std::vector<float> gSubBassDetuneVoicePositions {-1};
 float gSubBassAmp = 0.1;
 
 unsigned int gLeadDetuneVoices = 4;
-Wavetable2D gLeadOsc;
+// pool of lead voices, so arpeggiator notes can overlap
+VoiceAllocator gLeadVoices;
 std::vector<float> gLeadDetuneVoicePositions {-1, -0.3, 0.3, 1};
 std::pair<int, float> gLeadNoteAmp;
 // float gLeadAmp = 0.8;
@@ -49,9 +62,18 @@ std::pair<int, float> gLeadNoteAmp;
 // flag to determine whether lead should be played
 // int gPlayLead = 0;
 
+// oscillator output for the current audio block
+std::vector<float> gBassOscBufferLeft;
+std::vector<float> gBassOscBufferRight;
+std::vector<float> gSubBassOscBuffer;
+std::vector<float> gLeadBufferLeft;		// (filtered and enveloped lead voices)
+std::vector<float> gLeadBufferRight;
+
 // filters
-MoogFilter gBassFilt;
-MoogFilter gLeadFilt;
+MoogFilterBank gBassFilt;		// lane 0 left, lane 1 right
+// ladder oversampling (1, 2 or 4): the resonant lead aliases at 1x, the bass stays cheap
+const unsigned int kBassFiltOversampling = 1;
+const unsigned int kLeadFiltOversampling = 2;
 // lead filter resonance
 float gLeadFiltCutoff = 2030;
 
@@ -74,11 +96,12 @@ void nextEvent();
 // // patterns
 // const std::vector<int> gPatterns {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
 
-// ADSR
+// ADSR (evaluated at control rate)
 ADSR gBassAmpADSR;
 ADSR gBassFiltADSR;
-ADSR gLeadAmpADSR;
-ADSR gLeadFiltADSR;
+ControlRamp gBassAmpRamp;				// bass envelope, ramped between control updates
+unsigned int gBassControlPhase = 0;		// samples until the next bass control update
+bool gBassSounding = false;				// from a bass note until its envelope has finished and the filter settled
 
 // Device for handling MIDI messages
 Midi gMidi;
@@ -212,10 +235,17 @@ unsigned int gArpTempDist = 0;		// choice of distribution for harmonic note opti
 // initialise arpeggiator
 ProbabilisticArp gArp(ksubBeatsPerBeat, kBeatsPerBar, kBarsPerPattern, kLowestArpNote, 
 					  kArpOctaveRange, gArpSeed1, gArpSeed2, gArpSeedBalance, gArpTempDist);
+// steps are generated ahead in a low priority task, so the audio thread only takes them off a queue
+// (once set up, the arpeggiator is only changed through the lookahead, from any thread)
+const unsigned int kArpLookaheadSteps = 8;
+ArpLookahead gArpLookahead(gArp, kArpLookaheadSteps);
+AuxiliaryTask gArpLookaheadTask;
+void fillArpLookahead(void*) {gArpLookahead.fill(); }
 // for updating temperature controls via MIDI
 float gArpOverallTemperature = 0;
+// seed sequences imported from MIDI files (see tools/SeedImporter.cpp), used instead of the built-in ones if the file is there
+std::string gArpSeedBankFilename = "seeds.bank";
 // get useful values from gArp
-const unsigned int kArpNumSeeds = gArp.numSeeds();
 const unsigned int kArpNumTempDists = gArp.getNumTempDists();
 
 // Object that handles playing sound from a file
@@ -241,62 +271,45 @@ Scope gScope;
 
 bool setup(BelaContext *context, void *userData)
 {
-	// initialise wavetable buffer
-	std::vector<float> wavetableSaw(kWavetableSize);
-	// populate buffer with basic waveform
-	for (unsigned int n = 0; n < wavetableSaw.size(); n++) {
-		wavetableSaw[n] = powf(2.0 * (float)n / (float)wavetableSaw.size() - 1, 2);
-	} 
-	// apply filter [H(z) = (1 - Z^-2) / 2]
-	float first_val = wavetableSaw[0] - wavetableSaw[wavetableSaw.size() - 1];
-	float second_val = wavetableSaw[1] - wavetableSaw.back();
-	for (unsigned int n = wavetableSaw.size() - 1; n >= 2; n--) {
-		wavetableSaw[n] = (wavetableSaw[n] - wavetableSaw[n-2]) / 2.0;
+	// render() writes each output channel as a contiguous block
+	if(context->flags & BELA_FLAG_INTERLEAVED) {
+		rt_printf("Interleaved audio is not supported\n");
+		return false;
 	}
-	wavetableSaw[0] = first_val;
-	wavetableSaw[1] = second_val;
-	// 
-	// normalise saw wavetable
-	float max_elem = *std::max_element(wavetableSaw.begin(), wavetableSaw.end());
-	for (unsigned int n = 0; n < wavetableSaw.size(); n++) {
-		wavetableSaw[n] /= max_elem;
-	} 
-	// generate square wave buffer
-	std::vector<float> wavetableSquare(kWavetableSize);
-	for (unsigned int n = 0; n < wavetableSquare.size(); n++) {
-		unsigned int shiftPos = (n + (wavetableSquare.size() / 2)) % wavetableSquare.size();
-		wavetableSquare[n] = wavetableSaw[n] - wavetableSaw[shiftPos];
-	} 
-	// normalise square wavetable
-	max_elem = *std::max_element(wavetableSquare.begin(), wavetableSquare.end());
-	for (unsigned int n = 0; n < wavetableSquare.size(); n++) {
-		wavetableSquare[n] /= max_elem;
-	} 	
 	
-	// initialise oscillator wavetables
-	gBassOsc.setup(context->audioSampleRate, wavetableSaw, wavetableSquare, kWavetable2DSize, gBassDetuneVoices, gBassDetuneVoicePositions);
-	gSubBassOsc.setup(context->audioSampleRate, wavetableSquare, gSubBassDetuneVoices, gSubBassDetuneVoicePositions);
-	gLeadOsc.setup(context->audioSampleRate, wavetableSaw, wavetableSquare, kWavetable2DSize, gLeadDetuneVoices, gLeadDetuneVoicePositions);
+	// build the shared wavetables once, then point every oscillator at them
+	// (the saw and square source waves are generated at compile time, see Wavetables.h)
+	gWavetableBank = WavetableBank::create(kSawWavetable.data(), kSquareWavetable.data(), kWavetableSize, kWavetable2DSize);
+	
+	// initialise oscillator wavetables (the sub bass plays the last row: pure square)
+	gBassOsc.setup(context->audioSampleRate, gWavetableBank, gBassDetuneVoices, gBassDetuneVoicePositions);
+	gSubBassOsc.setup(context->audioSampleRate, gWavetableBank, gWavetableBank->numRows() - 1, gSubBassDetuneVoices, gSubBassDetuneVoicePositions);
+	gLeadVoices.setup(context->audioSampleRate, gWavetableBank, gLeadDetuneVoices, gLeadDetuneVoicePositions);
 	// setup wavetable poisition
-	gLeadOsc.setTable(0.1);
+	gLeadVoices.setTable(0.1);
+	// oscillators are rendered a block at a time
+	gBassOscBufferLeft.resize(context->audioFrames);
+	gBassOscBufferRight.resize(context->audioFrames);
+	gSubBassOscBuffer.resize(context->audioFrames);
+	gLeadBufferLeft.resize(context->audioFrames);
+	gLeadBufferRight.resize(context->audioFrames);
 
 	// initialise filters
-	gBassFilt.setup(context->audioSampleRate, 1);
-	gLeadFilt.setup(context->audioSampleRate, 1);
+	gBassFilt.setup(context->audioSampleRate, MoogFilter::kLowpass12);
+	gBassFilt.set_oversampling(kBassFiltOversampling);
+	gLeadVoices.setFilterOversampling(kLeadFiltOversampling);
 
 	// initialise the ADSR objects
-	gBassAmpADSR.setSampleRate(context->audioSampleRate);
-	gBassFiltADSR.setSampleRate(context->audioSampleRate);
-	gLeadAmpADSR.setSampleRate(context->audioSampleRate);
-	gLeadFiltADSR.setSampleRate(context->audioSampleRate);
+	gBassAmpADSR.setSampleRate(context->audioSampleRate / kControlPeriod);
+	gBassFiltADSR.setSampleRate(context->audioSampleRate / kControlPeriod);
 	
 	// initialise with default values when GUI is not used
-	gLeadAmpADSR.setAttackTime(0.012);
-	gLeadAmpADSR.setDecayTime(0.03);
-	gLeadAmpADSR.setSustainLevel(0.03);
-	gLeadFiltADSR.setAttackTime(0.006);
-	gLeadFiltADSR.setDecayTime(0.0035);
-	gLeadFiltADSR.setSustainLevel(0.2);
+	gLeadVoices.setAmpAttackTime(0.012);
+	gLeadVoices.setAmpDecayTime(0.03);
+	gLeadVoices.setAmpSustainLevel(0.03);
+	gLeadVoices.setFilterAttackTime(0.006);
+	gLeadVoices.setFilterDecayTime(0.0035);
+	gLeadVoices.setFilterSustainLevel(0.2);
 	
 	// Initialise the MIDI device
 	if(gMidi.readFrom(gMidiPort0) < 0) {
@@ -307,6 +320,12 @@ bool setup(BelaContext *context, void *userData)
 	gMidi.enableParser(true);	
 	gMidi.setParserCallback(midiEvent, (void *)gMidiPort0);
 	
+	// background generation of arpeggiator steps
+	if((gArpLookaheadTask = Bela_createAuxiliaryTask(fillArpLookahead, 20, "arp-lookahead")) == 0) {
+		rt_printf("Unable to create the arpeggiator lookahead task\n");
+		return false;
+	}
+	
 	// set up MIDI Looper
 	gBassLoop.setup(context->audioSampleRate, gTempo, kBeatsPerBar, kBarsPerPattern, kLooperMIDIRes, kNoMessage);
 	
@@ -354,20 +373,42 @@ bool setup(BelaContext *context, void *userData)
     
     // set up the Probabilistic ArpSynth
     gArp.setMetre(ksubBeatsPerBeat, kBeatsPerBar, kBarsPerPattern);
+    // the bank is mapped rather than read, so it costs next to nothing however many seeds it holds
+    if (std::shared_ptr<const SeedBank> seedBank = SeedBank::open(gArpSeedBankFilename)) {
+    	if (seedBank->length() < gArp.getSequenceLength()) {
+    		rt_printf("The seeds in '%s' are too short for the pattern: using the built-in seeds\n", gArpSeedBankFilename.c_str());
+    	}
+    	else if (seedBank->subBeatsPerBeat() != ksubBeatsPerBeat || seedBank->beatsPerBar() != kBeatsPerBar) {
+    		// the steps would land on the wrong beats
+    		rt_printf("The seeds in '%s' were quantised to %u x %u, not the pattern's %u x %u: using the built-in seeds\n", 
+    				  gArpSeedBankFilename.c_str(), seedBank->subBeatsPerBeat(), seedBank->beatsPerBar(), ksubBeatsPerBeat, kBeatsPerBar);
+    	}
+    	else {
+    		gArp.setSeedBank(seedBank);
+    		gArp.resetToSeed();
+    		rt_printf("Loaded %u arpeggiator seeds from '%s'\n", seedBank->size(), gArpSeedBankFilename.c_str());
+    	}
+    }
+    else {
+    	rt_printf("Using the built-in arpeggiator seeds\n");
+    }
+    gArpSeed1 = gArp.getSeeds()[0];
+    gArpSeed2 = gArp.getSeeds()[1];
+    // from here on the arpeggiator's settings are only changed through the lookahead, which takes the seeds the bank left
+    gArpLookahead.setSeed(gArpSeed1, gArpSeed2);
 
 	// Set up the GUI
-	float table_inc = 1.0 / (float)(kWavetable2DSize - 1);
 	gGui.setup(context->projectName);
 	gGuiController.setup(&gGui, "ArpSynth Controller");	
 	gGuiController.addSlider("Global Amplitude", 0.6, 0, 1.0, 0);
-	gGuiController.addSlider("Bass Saw-Square mix", 0, 0, 1.0, table_inc);
+	gGuiController.addSlider("Bass Saw-Square mix", 0, 0, 1.0, 0);
 	gGuiController.addSlider("Bass Pitch", 0, 0, 12, 1);
 	gGuiController.addSlider("Bass Detune",  0.0002, 0, 0.01, 0);
 	gGuiController.addSlider("Bass Amplitude", -9, -40, -6, 0);
 	gGuiController.addSlider("Bass Filt cutoff", 1160, 100, 5000, 0);
 	gGuiController.addSlider("Bass Filt Resonance", 0, 0, 1.1, 0);
 	gGuiController.addSlider("Sub Bass Amplitude", -25, -40, -6, 0);
-	gGuiController.addSlider("Lead Saw-Square mix", 0.1, 0, 1.0, table_inc);
+	gGuiController.addSlider("Lead Saw-Square mix", 0.1, 0, 1.0, 0);
 	gGuiController.addSlider("Lead Pitch", 0, 0, 36, 1);
 	gGuiController.addSlider("Lead Detune",  0.0004, 0, 0.01, 0);
 	gGuiController.addSlider("Lead Amplitude", -0.1, -40, 0, 0);
@@ -384,12 +425,14 @@ bool setup(BelaContext *context, void *userData)
 	gGuiController.addSlider("Lead Filt ADSR R", 0.01, 0, 0.1, 0);
 	gGuiController.addSlider("Kick Amplitude", 0.6, 0, 1.0, 0);
 	gGuiController.addSlider("Tempo", 120.0, kMinTempo, kMaxTempo, 1);
-	gGuiController.addSlider("Arp Seed1", gArpSeed1, 0, kArpNumSeeds - 1, 1);
-	gGuiController.addSlider("Arp Seed2", gArpSeed2, 0, kArpNumSeeds - 1, 1);
+	gGuiController.addSlider("Arp Seed1", gArpSeed1, 0, gArp.numSeeds() - 1, 1);
+	gGuiController.addSlider("Arp Seed2", gArpSeed2, 0, gArp.numSeeds() - 1, 1);
 	gGuiController.addSlider("Temperature Dist", gArpTempDist, 0, kArpNumTempDists - 1, 1);
+	gGuiController.addSlider("Bass Unison Voices", gBassDetuneVoices, 1, WavetableVoices::kMaxVoices, 1);
+	gGuiController.addSlider("Lead Unison Voices", gLeadDetuneVoices, 1, WavetableVoices::kMaxVoices, 1);
 	
 	// Set up the oscilloscope
-	gScope.setup(1, context->audioSampleRate);
+	gScope.setup(2, context->audioSampleRate);
 
 	return true;
 }
@@ -397,6 +440,9 @@ bool setup(BelaContext *context, void *userData)
 
 void render(BelaContext *context, void *userData)
 {
+	// flush subnormals to zero in the audio thread for the whole callback
+	ScopedFlushDenormals noDenormals;
+	
 	// read GUI slider values
 	float globalAmplitude = gGuiController.getSliderValue(0);	
 	// float bassWavetablePos = gGuiController.getSliderValue(1);
@@ -426,6 +472,8 @@ void render(BelaContext *context, void *userData)
 	unsigned int arpSeed1 = gGuiController.getSliderValue(25);
 	unsigned int arpSeed2 = gGuiController.getSliderValue(26);
 	unsigned int arpTempDist = gGuiController.getSliderValue(27);
+	unsigned int bassVoices = gGuiController.getSliderValue(28);
+	unsigned int leadVoices = gGuiController.getSliderValue(29);
 	
 	// set tempo
 	// gTempo = tempo;
@@ -439,22 +487,33 @@ void render(BelaContext *context, void *userData)
 	// gBassOsc.setFrequency(bassCentreFreq);
 	// gBassOsc.setDetune(bassDetune);
 	
+	// change the number of unison voices (spread evenly, without allocating)
+	if (bassVoices != gBassDetuneVoices) {
+		gBassDetuneVoices = bassVoices;
+		gBassOsc.setVoices(bassVoices);
+	}
+	
 	// kick
-	gKickAmp = powf(10.0, kickAmplitudeDB / 20.0) * 2.0;
+	gKickAmp = fastmath::pow(10.0f, kickAmplitudeDB / 20.0) * 2.0;
 	
 	// set the sub bass parameters
-	gSubBassAmp = powf(10.0, subBassAmplitudeDB / 20.0);
+	gSubBassAmp = fastmath::pow(10.0f, subBassAmplitudeDB / 20.0);
 	
 	// set the lead parameters
 	// gLeadNote = leadPitch;		// convert semitones (above C2) to Hertz
-	// gLeadOsc.setTable(leadWavetablePos);
-	gLeadOsc.setDetune(leadDetune);
+	// gLeadVoices.setTable(leadWavetablePos);
+	gLeadVoices.setDetune(leadDetune);
+	if (leadVoices != gLeadDetuneVoices) {
+		gLeadDetuneVoices = leadVoices;
+		gLeadVoices.setUnisonVoices(leadVoices);
+	}
 	// convert amplitudes to linear
 	// gLeadAmp = powf(10.0, leadAmplitudeDB / 20.0);
 	
-	// calculate filter coefficients
-	gBassFilt.set_params(bassFiltCutoff, bassFiltRes);
-	gLeadFilt.set_params(gLeadFiltCutoff, leadFiltRes);
+	// filter parameters (the bass filter coefficients are set at control rate)
+	gLeadVoices.setFilterCutoff(gLeadFiltCutoff);
+	gLeadVoices.setFilterSensitivity(leadFiltSensitivity);
+	gLeadVoices.setFilterResonance(leadFiltRes);
 
 	// set ADSR parameters
 	gBassAmpADSR.setAttackTime(0.01);
@@ -467,27 +526,121 @@ void render(BelaContext *context, void *userData)
 	gBassFiltADSR.setSustainLevel(0.6);
 	gBassFiltADSR.setReleaseTime(0.3);
 	
-	// gLeadAmpADSR.setAttackTime(leadADSRa);
-	// gLeadAmpADSR.setDecayTime(leadADSRd);
-	// gLeadAmpADSR.setSustainLevel(leadADSRs);
-	gLeadAmpADSR.setReleaseTime(leadADSRr);
+	// gLeadVoices.setAmpAttackTime(leadADSRa);
+	// gLeadVoices.setAmpDecayTime(leadADSRd);
+	// gLeadVoices.setAmpSustainLevel(leadADSRs);
+	gLeadVoices.setAmpReleaseTime(leadADSRr);
 	
-	// gLeadFiltADSR.setAttackTime(leadFiltADSRa);
-	// gLeadFiltADSR.setDecayTime(leadFiltADSRd);
-	// gLeadFiltADSR.setSustainLevel(leadFiltADSRs);
-	gLeadFiltADSR.setReleaseTime(leadFiltADSRr);
+	// gLeadVoices.setFilterAttackTime(leadFiltADSRa);
+	// gLeadVoices.setFilterDecayTime(leadFiltADSRd);
+	// gLeadVoices.setFilterSustainLevel(leadFiltADSRs);
+	gLeadVoices.setFilterReleaseTime(leadFiltADSRr);
 	
-	// update arpeggiator seeds
-	gArp.setSeed(arpSeed1, arpSeed2);
+	// update arpeggiator seeds (only on a change: any change discards the steps generated ahead)
+	if ((int)arpSeed1 != gArpSeed1 || (int)arpSeed2 != gArpSeed2) {
+		gArpSeed1 = arpSeed1;
+		gArpSeed2 = arpSeed2;
+		gArpLookahead.setSeed(arpSeed1, arpSeed2);
+	}
 	
 	// set arpeggiator temperature distribution choice
-	gArp.setTempDistChoice(arpTempDist);
+	if (arpTempDist != gArpTempDist) {
+		gArpTempDist = arpTempDist;
+		gArpLookahead.setTempDistChoice(arpTempDist);
+	}
 	
 
+	// the output is written straight into the non-interleaved output buffer:
+	// each channel is a contiguous block of audioFrames samples
+	float* outLeft = context->audioOut;
+	float* outRight = context->audioOutChannels > 1 ? context->audioOut + context->audioFrames : nullptr;
+
+	// render the instruments for frames [start, end) of the block:
+	// the oscillators and filters a segment at a time, and the envelopes at control rate
+	auto renderSegment = [&](unsigned int start, unsigned int end) {
+		gLeadVoices.processBlock(&gLeadBufferLeft[start], &gLeadBufferRight[start], end - start);
+		
+		// an idle bass chain costs nothing
+		if (gBassSounding) {
+			gBassOsc.processBlock(&gBassOscBufferLeft[start], &gBassOscBufferRight[start], end - start);
+			gSubBassOsc.processBlock(&gSubBassOscBuffer[start], end - start);
+			
+			// bass envelopes and filter, a control period (or what is left of it) at a time
+			unsigned int position = start;
+			while (position < end) {
+		    	// control update: new envelope values, ramped to over the next control period
+		    	if (gBassControlPhase == 0) {
+		    		gBassAmpRamp.setTarget(gBassAmpADSR.process());
+		    		float bassfiltercontrol = gBassFiltADSR.process();
+		    		gBassFilt.ramp_params(0, bassFiltCutoff + bassfiltercontrol * 400, bassFiltRes, kControlPeriod);
+		    		gBassFilt.ramp_params(1, bassFiltCutoff + bassfiltercontrol * 400, bassFiltRes, kControlPeriod);
+		    		gBassControlPhase = kControlPeriod;
+		    	}
+		    	unsigned int length = std::min(gBassControlPhase, end - position);
+	    	
+		    	for(unsigned int n = position; n < position + length; n++) {
+			    	// get bass sample value from wavetable
+			    	float bassADSR = gBassAmpRamp.process();
+			    	float bassAmp = gBassAmp * bassADSR;
+			    	// play sub bassOut (in the centre)
+			    	float subBassAmp = gSubBassAmp * bassADSR;    
+			    	gBassOscBufferLeft[n] = gBassOscBufferLeft[n] * bassAmp + gSubBassOscBuffer[n] * subBassAmp;
+			    	gBassOscBufferRight[n] = gBassOscBufferRight[n] * bassAmp + gSubBassOscBuffer[n] * subBassAmp;
+		    	}
+	    	
+		    	// apply filter (lanes 2 and 3 are unused)
+		    	float* bassLanes[MoogFilterBank::kLanes] = {&gBassOscBufferLeft[position], &gBassOscBufferRight[position], nullptr, nullptr};
+		    	gBassFilt.process_block(bassLanes, bassLanes, length);
+	    	
+		    	position += length;
+		    	gBassControlPhase -= length;
+			}
+		
+			// a finished bass note stops once the filter has rung out
+			if (!gBassAmpADSR.isActive() && gBassFilt.is_settled(0) && gBassFilt.is_settled(1)) {
+				gBassFilt.clear(0);
+				gBassFilt.clear(1);
+				gBassSounding = false;
+			}
+		}
+		else {
+			std::fill(gBassOscBufferLeft.begin() + start, gBassOscBufferLeft.begin() + end, 0.0f);
+			std::fill(gBassOscBufferRight.begin() + start, gBassOscBufferRight.begin() + end, 0.0f);
+		}
+		
+		for(unsigned int n = start; n < end; n++) {
+	    	float bassOutLeft = gBassOscBufferLeft[n];
+	    	float bassOutRight = gBassOscBufferRight[n];
+	    	
+	    	// add kick
+	    	float kick = 0;
+			if (gPlayKick) {
+				kick = gPlayer.process() * gKickAmp * gKickAmpRed;
+			}
+				    	
+	    	// set audio output (the kick sits in the centre)
+	    	float left = (bassOutLeft + gLeadBufferLeft[n] + kick / 2.0) * globalAmplitude;
+	    	float right = (bassOutRight + gLeadBufferRight[n] + kick / 2.0) * globalAmplitude;
+	    	
+			// Write the samples to the left and right output channels
+			if (outRight != nullptr) {
+				outLeft[n] = left;
+				outRight[n] = right;
+			}
+			else {
+				outLeft[n] = 0.5 * (left + right);
+			}
+	    	
+	    	// Log the audio output to the scope
+	    	gScope.log(left, right);
+		}
+	};
+
 	// Audio loop
+	// bass looper notes and arpeggiator steps change the oscillator frequencies,
+	// so everything before each event is rendered first
+	unsigned int segmentStart = 0;
     for(unsigned int n = 0; n < context->audioFrames; n++) {
-    	float out = 0;
-    	
     	// process bass loop
     	gBassLoop.process();
     	// read from bass loop
@@ -497,12 +650,15 @@ void render(BelaContext *context, void *userData)
 			// rt_printf("Message from looper: {%d, %d, %d, %d}\n", gLoopNoteReadMessage[0], gLoopNoteReadMessage[1], gLoopNoteReadMessage[2], gLoopNoteReadMessage[3]);
     		
       		if (gLoopNoteReadMessage[2] != kNoMessage[2]) {
-    			gArp.modeChange(gLoopNoteReadMessage[2]);
+    			gArpLookahead.modeChange(gLoopNoteReadMessage[2]);
     		}
     		if (gLoopNoteReadMessage[3] != kNoMessage[3]) {
     			controlChange(kMIDIControllerLED, gLoopNoteReadMessage[3]);
     		}
     		if (gLoopNoteReadMessage[0] != kNoMessage[0]) {
+    			renderSegment(segmentStart, n);
+    			segmentStart = n;
+    			
     			// apply note on function
     			noteOn(gLoopNoteReadMessage[0], gLoopNoteReadMessage[1]);
     			// also apply note off
@@ -510,52 +666,25 @@ void render(BelaContext *context, void *userData)
     		}
     	}
     	
-    	// get bass sample value from wavetable
-    	float bassADSR = gBassAmpADSR.process();
-    	float bassAmp = gBassAmp * bassADSR;
-    	float bassOut = gBassOsc.process() * bassAmp;
-    	// play sub bassOut
-    	float subBassAmp = gSubBassAmp * bassADSR;    
-    	bassOut += gSubBassOsc.process() * subBassAmp;
-    	// apply filter
-    	float bassfiltercontrol = gBassFiltADSR.process();
-    	gBassFilt.set_params(bassFiltCutoff + bassfiltercontrol * 400, bassFiltRes);
-    	bassOut = gBassFilt.process(bassOut);
-    	
     	// play lead
     	// play next event
 		if (++gCounter >= 1.0 / (float)gTempo * 60.0 * context->audioSampleRate / (float)kBeatsPerBar) {
+			renderSegment(segmentStart, n);
+			segmentStart = n;
+			
 			nextEvent();
 
 			// reset counter
 			gCounter = 0;
 		}
-		
-		// get lead output
-		float leadAmp = std::get<1>(gLeadNoteAmp) * gLeadAmpADSR.process();		// output amplitude from the arpeggiator * envelope value
-		float leadOut = gLeadOsc.process() * leadAmp;
-		// apply filter
-    	float leadfiltercontrol = gLeadFiltADSR.process();
-    	gLeadFilt.set_params(gLeadFiltCutoff + leadfiltercontrol * leadFiltSensitivity, leadFiltRes);
-    	leadOut = gLeadFilt.process(leadOut);
-    	
-    	// add kick
-    	float kick = 0;
-		if (gPlayKick) {
-			kick = gPlayer.process() * gKickAmp * gKickAmpRed;
-		}
-		    	
-    	// set audio output
-    	out = bassOut + leadOut + kick / 2.0;
-    	out *= globalAmplitude;
-    	
-		// Write the sample to every audio output channel            
-    	for(unsigned int channel = 0; channel < context->audioOutChannels; channel++) {
-    		audioWrite(context, n, channel, out);
-    	}
-    	
-    	// Log the audio output and the envelope to the scope
-    	gScope.log(out);    	
+    }
+    
+    // render the remainder of the block
+    renderSegment(segmentStart, context->audioFrames);
+    
+    // top up the arpeggiator steps (or regenerate them after a change)
+    if (gArpLookahead.needsFill()) {
+    	Bela_scheduleAuxiliaryTask(gArpLookaheadTask);
     }
 }
 
@@ -623,7 +752,7 @@ void noteOn(int noteNumber, int velocity)
 	rt_printf("Note on message received: %d\n", noteNumber);
 	
 	// Map note number to frequency
-	float bassCentreFreq = 65.41 * powf(2.0, (noteNumber - 36) / 12.0);
+	float bassCentreFreq = 65.41 * fastmath::exp2((noteNumber - 36) / 12.0);
 	gBassOsc.setFrequency(bassCentreFreq);
 	
 	// set sub bass oscillator
@@ -633,7 +762,12 @@ void noteOn(int noteNumber, int velocity)
 	// float decibels = map(velocity, 1, 127, -40, 0);
 	// gBassAmp = powf(10.0, decibels / 20.0);
 
-	// trigger envelopes
+	// trigger envelopes (an idle bass chain restarts from silence, with a control update straight away)
+	if (!gBassSounding) {
+		gBassAmpRamp.reset(0);
+		gBassControlPhase = 0;
+		gBassSounding = true;
+	}
 	gBassAmpADSR.trigger();
 	gBassFiltADSR.trigger();
 	
@@ -641,12 +775,12 @@ void noteOn(int noteNumber, int velocity)
 	gBassNote = noteNumber;
 	
 	// set key 
-	gArp.keyChange(noteNumber % 12);
+	gArpLookahead.keyChange(noteNumber % 12);
 	
 	// write message to bass Looper
 	gLoopNoteWriteMessage[0] = noteNumber;
 	gLoopNoteWriteMessage[1] = velocity;
-	gLoopNoteWriteMessage[2] = gArp.getMode();
+	gLoopNoteWriteMessage[2] = gArpLookahead.getMode();
 	gBassLoop.write(gLoopNoteWriteMessage);
 	
 	rt_printf("Wrote message to looper: {%d, %d, %d, %d}\n", gLoopNoteWriteMessage[0], gLoopNoteWriteMessage[1], gLoopNoteWriteMessage[2], gLoopNoteWriteMessage[3]);
@@ -721,8 +855,8 @@ void controlChange(int controller, int value)
 		// rt_printf("Lead Play CC received, value %d\n", value);
 		
 		if (value > 0) {
-			if (!gArp.isPlaying()) {
-				gArp.play();
+			if (!gArpLookahead.isPlaying()) {
+				gArpLookahead.play();
 	
 				// send an LED on message to QuNeo
 				int message = gMidi.writeNoteOn(0, kLEDArp, 127);
@@ -730,13 +864,12 @@ void controlChange(int controller, int value)
 			}
 			else {
 				// stop playing Arpeggiator
-				gArp.stop();
+				gArpLookahead.stop();
 				
-				// reset previous sequence buffer to the seed sequence
-				gArp.resetToSeed();
+				// reset previous sequence buffer to the seed sequence (before the next step is generated)
+				gArpLookahead.resetToSeed();
 				
-				gLeadAmpADSR.release();
-				gLeadFiltADSR.release();
+				gLeadVoices.releaseAll();
 	
 				// send an LED off message to QuNeo
 				int message = gMidi.writeNoteOff(0, kLEDArp, 0);
@@ -791,7 +924,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 
 		// update Arpeggiator control
-		gArp.setContourTemp(temp);
+		gArpLookahead.setContourTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -803,7 +936,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setHarmonicTemp(temp);
+		gArpLookahead.setHarmonicTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -815,7 +948,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setRhythmicTemp(temp);
+		gArpLookahead.setRhythmicTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -827,7 +960,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setDynamicContourTemp(temp);
+		gArpLookahead.setDynamicContourTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -839,7 +972,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setIntervalTemp(temp);
+		gArpLookahead.setIntervalTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -851,7 +984,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setSparsity(temp);
+		gArpLookahead.setSparsity(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -863,7 +996,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setMovement(temp);
+		gArpLookahead.setMovement(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -875,7 +1008,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setDynamicTemp(temp);
+		gArpLookahead.setDynamicTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -887,7 +1020,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setConsistency(temp);
+		gArpLookahead.setConsistency(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -899,7 +1032,7 @@ void controlChange(int controller, int value)
 		float temp = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setPitchTemp(temp);
+		gArpLookahead.setPitchTemp(temp);
 		
 		// adjust overall temp LED
 		overallTempLEDMidiMessage();
@@ -911,7 +1044,7 @@ void controlChange(int controller, int value)
 		float balance = map(value, 0, 127, 0.0, 1.0);
 		
 		// update Arpeggiator control
-		gArp.setSeedBalance(balance);
+		gArpLookahead.setSeedBalance(balance);
 		
 		// send an LED message to QuNeo
 		int message = gMidi.writeControlChange(0, kLEDSeedBalance, value);
@@ -934,7 +1067,7 @@ void controlChange(int controller, int value)
 
 		// update Arpeggiator controls by the change in ratio
 		// Note: a negative value results in a decrease by that proportion
-		gArp.changeAllTempsByProportion(proportion);
+		gArpLookahead.changeAllTempsByProportion(proportion);
 		
 		// send an LED message to QuNeo
 		int message = gMidi.writeControlChange(0, kLEDTempOverall, value);
@@ -944,7 +1077,7 @@ void controlChange(int controller, int value)
 	}
 	else if(controller == kMIDIControllerBassAmp) {
 		float decibels = map(value, 0, 127, -40, 0);
-		gBassAmp = powf(10.0, decibels / 20.0);	
+		gBassAmp = fastmath::pow(10.0f, decibels / 20.0);	
 		
 		// rt_printf("Set Bass amplitude to %f\n", gBassAmp);
 	}	
@@ -962,34 +1095,34 @@ void controlChange(int controller, int value)
 	}
 	else if(controller == kMIDIControllerLeadWavetableMix) {
 		float mix = map(value, 0, 127, 0, 1.0);
-		gLeadOsc.setTable(mix);
+		gLeadVoices.setTable(mix);
 	}
 	else if(controller == kMIDIControllerLeadADSRa) {
 		float val = map(value, 0, 127, 0, 0.1);
-		gLeadAmpADSR.setAttackTime(val);
+		gLeadVoices.setAmpAttackTime(val);
 	}
 	else if(controller == kMIDIControllerLeadADSRd) {
 		float val = map(value, 0, 127, 0, 0.1);
-		gLeadAmpADSR.setDecayTime(val);
+		gLeadVoices.setAmpDecayTime(val);
 	}
 	else if(controller == kMIDIControllerLeadADSRs) {
 		float val = map(value, 0, 127, 0, 1.0);
-		gLeadAmpADSR.setSustainLevel(val);
+		gLeadVoices.setAmpSustainLevel(val);
 	}
 	else if(controller == kMIDIControllerLeadFiltCutoff) {
 		gLeadFiltCutoff = map(value, 0, 127, 1000, 10000);
 	}
 	else if(controller == kMIDIControllerLeadFiltADSRa) {
 		float val = map(value, 0, 127, 0, 0.1);
-		gLeadFiltADSR.setAttackTime(val);
+		gLeadVoices.setFilterAttackTime(val);
 	}
 	else if(controller == kMIDIControllerLeadFiltADSRd) {
 		float val = map(value, 0, 127, 0, 0.1);
-		gLeadFiltADSR.setDecayTime(val);
+		gLeadVoices.setFilterDecayTime(val);
 	}
 	else if(controller == kMIDIControllerLeadFiltADSRs) {
 		float val = map(value, 0, 127, 0, 1.0);
-		gLeadFiltADSR.setSustainLevel(val);
+		gLeadVoices.setFilterSustainLevel(val);
 	}
 	else if(controller == kMIDIControllerMode) { 
 		// left side pad hits give mode 0 (major key)
@@ -1000,7 +1133,7 @@ void controlChange(int controller, int value)
 		}
 		
 		// update Arpeggiator
-		gArp.modeChange(mode);
+		gArpLookahead.modeChange(mode);
 		
 		// rt_printf("Mode changed to %d\n", mode);
 	}
@@ -1017,7 +1150,7 @@ void controlChange(int controller, int value)
 			
 			gBassLED1 = value;		// this corresponds to the positions of NoteOn values for the controller pads (bottom right LEDs)
 			gBassLED2 = value + 16;
-			int mode = gArp.getMode();
+			int mode = gArpLookahead.getMode();
 			if (mode == 0) {
 				gBassLED1 -= 2;
 				gBassLED2 -= 2;
@@ -1036,29 +1169,25 @@ void controlChange(int controller, int value)
 
 void nextEvent() {
 	
-	// move on the metre counter
-	gArp.beat();
+	// move on the metre counter and get the step generated for it
+	ArpLookahead::Step step = gArpLookahead.next();
 	
 	// Map velocity to amplitude on a decibel scale
 	// float decibels = map(velocity, 1, 127, -40, 0);
 	// gBassAmp = powf(10.0, decibels / 20.0);
 
-	if (gArp.isPlaying()) {
+	if (gArpLookahead.isPlaying()) {
 		// get note and amplitude pair
-		gLeadNoteAmp = gArp.generate();	
+		gLeadNoteAmp = step.noteAmp;
 		// check for a 'no note'
 		if (std::get<0>(gLeadNoteAmp) != -1) {
-			// set lead oscillator frequency
-			float leadCentreFreq = 130.81 * powf(2.0, (std::get<0>(gLeadNoteAmp) - 48) / 12.0);
-			gLeadOsc.setFrequency(leadCentreFreq);
-			
-			// trigger envelopes
-			gLeadAmpADSR.trigger();
-			gLeadFiltADSR.trigger();
+			// start a lead voice at the note frequency (the previous note is released)
+			float leadCentreFreq = 130.81 * fastmath::exp2((std::get<0>(gLeadNoteAmp) - 48) / 12.0);
+			gLeadVoices.noteOn(leadCentreFreq, std::get<1>(gLeadNoteAmp));
 		}
 	}
 	
-	int beat = gArp.getSequencePosition();
+	int beat = step.position;
 	
 	// add kick
 	if (beat % ksubBeatsPerBeat == 0) {
@@ -1091,7 +1220,7 @@ void nextEvent() {
 void overallTempLEDMidiMessage()
 {
 	// get overall temperature proportion
-	float temp = gArp.getOverallTemp();
+	float temp = gArpLookahead.getOverallTemp();
 	// send an LED message to QuNeo
 	int tempCC = map(temp, 0.0, 1.0, 0, 127);
 	int message = gMidi.writeControlChange(0, kLEDTempOverall, tempCC);
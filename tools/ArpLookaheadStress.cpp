@@ -0,0 +1,218 @@
+/***** ArpLookaheadStress.cpp *****/
+
+/*
+Checks ArpLookahead two ways:
+	interleavings	one thread calls next(), fill() and the setters in a random order, and
+					every step must match an arpeggiator driven directly with the same settings
+	threads			a worker calling fill(), an audio thread calling next() and a MIDI
+					thread calling the setters all run at once, and the steps must come out
+					with consecutive positions and indices (none lost, none played twice);
+					once with the worker filling when needsFill() says so, as render.cpp
+					schedules it, and once with it filling all the time, so that it often
+					holds the arpeggiator when the audio thread wants it
+Host tool, not part of the Bela project. Build from this directory with:
+	g++ -std=c++14 -O2 -pthread -Drt_printf=printf -I.. ArpLookaheadStress.cpp ../ArpLookahead.cpp ../ProbabilisticArp.cpp ../Sampler.cpp ../SeedBank.cpp -o ArpLookaheadStress
+and for the threads, again with -fsanitize=thread -g in place of -O2.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <utility>
+#include "ArpLookahead.h"
+#include "ProbabilisticArp.h"
+
+// arpeggiator set up as in render.cpp
+const unsigned int kSubBeatsPerBeat = 4;
+const unsigned int kBeatsPerBar = 4;
+const unsigned int kBarsPerPattern = 4;
+const unsigned int kLowestNote = 48;
+const unsigned int kOctaves = 4;
+const int64_t kRandomSeed = 1;
+
+const unsigned int kInterleavingRuns = 32;
+const unsigned int kInterleavingCalls = 20000;
+const unsigned int kThreadSteps = 200000;
+
+static ProbabilisticArp makeArp()
+{
+	ProbabilisticArp arp(kSubBeatsPerBeat, kBeatsPerBar, kBarsPerPattern, kLowestNote, kOctaves, 0, 1, 0, 0, kRandomSeed);
+	arp.play();
+	return arp;
+}
+
+// a control value as it comes from MIDI, so that some changes set the value already there
+static float controlValue(std::mt19937& gen) {return (gen() % 128) / 127.0f; }
+
+// one random change to the settings, through the lookahead and, if there is one, straight to the reference
+static void randomChange(std::mt19937& gen, ArpLookahead& lookahead, ProbabilisticArp* reference)
+{
+	float value = controlValue(gen);
+	switch (gen() % 18) {
+		case 0: lookahead.setIntervalTemp(value); if (reference) reference->setIntervalTemp(value); break;
+		case 1: lookahead.setContourTemp(value); if (reference) reference->setContourTemp(value); break;
+		case 2: lookahead.setRhythmicTemp(value); if (reference) reference->setRhythmicTemp(value); break;
+		case 3: lookahead.setSparsity(value); if (reference) reference->setSparsity(value); break;
+		case 4: lookahead.setConsistency(value); if (reference) reference->setConsistency(value); break;
+		case 5: lookahead.setMovement(value); if (reference) reference->setMovement(value); break;
+		case 6: lookahead.setHarmonicTemp(value); if (reference) reference->setHarmonicTemp(value); break;
+		case 7: lookahead.setDynamicTemp(value); if (reference) reference->setDynamicTemp(value); break;
+		case 8: lookahead.setDynamicContourTemp(value); if (reference) reference->setDynamicContourTemp(value); break;
+		case 9: lookahead.setPitchTemp(value); if (reference) reference->setPitchTemp(value); break;
+		case 10: {
+			float proportion = value - 0.5f;
+			lookahead.changeAllTempsByProportion(proportion);
+			if (reference) reference->changeAllTempsByProportion(proportion);
+			break;
+		}
+		case 11: {
+			int seed1 = gen() % 4;
+			int seed2 = gen() % 4;
+			lookahead.setSeed(seed1, seed2);
+			if (reference) reference->setSeed(seed1, seed2);
+			break;
+		}
+		case 12: lookahead.setSeedBalance(value); if (reference) reference->setSeedBalance(value); break;
+		case 13: {
+			unsigned int choice = gen() % 3;
+			lookahead.setTempDistChoice(choice);
+			if (reference) reference->setTempDistChoice(choice);
+			break;
+		}
+		case 14: {
+			unsigned int key = gen() % 12;
+			lookahead.keyChange(key);
+			if (reference) reference->keyChange(key);
+			break;
+		}
+		case 15: {
+			unsigned int mode = gen() % 2;
+			lookahead.modeChange(mode);
+			if (reference) reference->modeChange(mode);
+			break;
+		}
+		case 16:
+			// stopping resets to the seed, as in render.cpp
+			if (gen() % 2) {
+				lookahead.play();
+				if (reference) reference->play();
+			}
+			else {
+				lookahead.stop();
+				lookahead.resetToSeed();
+				if (reference) {
+					reference->stop();
+					reference->resetToSeed();
+				}
+			}
+			break;
+		default: lookahead.resetToSeed(); if (reference) reference->resetToSeed(); break;
+	}
+}
+
+// the step the lookahead should give
+static ArpLookahead::Step referenceStep(ProbabilisticArp& reference)
+{
+	reference.beat();
+	ArpLookahead::Step step {0, 0, reference.getSequencePosition(), {-1, 0.0f}};
+	if (reference.isPlaying()) {
+		step.noteAmp = reference.generate();
+	}
+	return step;
+}
+
+static bool interleavings()
+{
+	unsigned int steps = 0;
+	for (unsigned int run = 0; run < kInterleavingRuns; run++) {
+		std::mt19937 gen(run);
+		ProbabilisticArp arp = makeArp();
+		ProbabilisticArp reference = makeArp();
+		ArpLookahead lookahead(arp, 1 + run % ArpLookahead::kMaxSteps);
+		uint16_t index = 0;
+
+		for (unsigned int call = 0; call < kInterleavingCalls; call++) {
+			unsigned int which = gen() % 10;
+			if (which < 4) {
+				ArpLookahead::Step step = lookahead.next();
+				ArpLookahead::Step expected = referenceStep(reference);
+				if (step.index != index || step.position != expected.position || step.noteAmp != expected.noteAmp) {
+					printf("interleavings: run %u, call %u: step %u at %u {%d, %f}, expected step %u at %u {%d, %f}\n",
+						   run, call, step.index, step.position, step.noteAmp.first, step.noteAmp.second,
+						   index, expected.position, expected.noteAmp.first, expected.noteAmp.second);
+					return false;
+				}
+				index++;
+				steps++;
+			}
+			else if (which < 7) {
+				lookahead.fill();
+			}
+			else {
+				randomChange(gen, lookahead, &reference);
+			}
+		}
+	}
+	printf("interleavings: %u runs, %u steps matched the directly driven arpeggiator\n", kInterleavingRuns, steps);
+	return true;
+}
+
+static bool threads(bool greedy)
+{
+	ProbabilisticArp arp = makeArp();
+	ArpLookahead lookahead(arp, 8);
+	std::atomic<bool> done {false};
+
+	std::thread worker([&] {
+		while (!done.load()) {
+			if (greedy || lookahead.needsFill()) {
+				lookahead.fill();
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	});
+	std::thread midi([&] {
+		std::mt19937 gen(1);
+		while (!done.load()) {
+			randomChange(gen, lookahead, nullptr);
+			std::this_thread::sleep_for(std::chrono::microseconds(gen() % 100));
+		}
+	});
+
+	// the audio thread
+	bool ok = true;
+	ArpLookahead::Step previous = lookahead.next();
+	unsigned int length = arp.getSequenceLength();
+	for (unsigned int n = 1; n < kThreadSteps && ok; n++) {
+		ArpLookahead::Step step = lookahead.next();
+		if (step.index != (uint16_t)(previous.index + 1) || step.position != (previous.position + 1) % length) {
+			printf("threads: step %u at %u followed step %u at %u\n", step.index, step.position, previous.index, previous.position);
+			ok = false;
+		}
+		previous = step;
+		if (n % 16 == 0) {
+			std::this_thread::yield();
+		}
+	}
+
+	done.store(true);
+	worker.join();
+	midi.join();
+	if (ok) {
+		printf("threads (worker %s): %u steps, positions and indices consecutive\n", greedy ? "always filling" : "as scheduled", kThreadSteps);
+	}
+	return ok;
+}
+
+int main()
+{
+	bool ok = interleavings();
+	ok = threads(false) && ok;
+	ok = threads(true) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,409 @@
+/***** ArpMonteCarlo.cpp *****/
+
+/*
+Output statistics of the arpeggiator over a grid of its controls, for tuning the
+temperatures without listening. Every grid point runs a number of independent chains
+(each starting from the seed sequence, as when the lead starts playing) and counts
+	pitch class		of each note
+	interval		in semitones from the previous note (rests skipped)
+	density			notes in each bar
+	dynamics		amplitude of each note, in kDynamicsBins bins over [0, kMaxAmplitude)
+The chains are shared out between threads, and each has its own generator seeded from
+the base seed, grid point and chain number, so the output depends on those and the
+settings but never on the number of threads.
+
+Host tool, not part of the Bela project. Build from this directory with:
+	g++ -std=c++14 -O2 -pthread -Drt_printf=printf -I.. ArpMonteCarlo.cpp ../ProbabilisticArp.cpp ../Sampler.cpp ../SeedBank.cpp -o ArpMonteCarlo
+Run with --help for the options. For example, the harmonic temperature and sparsity
+at five levels each, everything else at 0.2, for the first two seeds:
+	./ArpMonteCarlo --sweep harmonic,sparsity --levels 5 --fixed 0.2 --seeds 0:1 --output grid.csv
+
+CSV output has one row per grid point: the seeds, the control values, then the counts
+of every histogram bin. Binary output (--format binary) is, in native byte order:
+	char[8]		"ARPMC1\0\0"
+	uint32		grid points, controls, pitch class bins, interval bins, density bins, dynamics bins
+	then for each grid point:
+	int32		seed 1, seed 2
+	float		the control values, in the order of kControls
+	uint64		the counts of every histogram bin, in the order above
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ProbabilisticArp.h"
+
+// arpeggiator set up as in render.cpp
+const unsigned int kSubBeatsPerBeat = 4;
+const unsigned int kBeatsPerBar = 4;
+const unsigned int kBarsPerPattern = 4;
+const unsigned int kLowestNote = 48;
+const unsigned int kOctaves = 4;
+
+// histogram sizes
+const unsigned int kPitchClassBins = 12;
+const int kMaxInterval = kOctaves * 12 - 1;
+const unsigned int kIntervalBins = 2 * kMaxInterval + 1;			// -kMaxInterval to kMaxInterval
+const unsigned int kDensityBins = kSubBeatsPerBeat * kBeatsPerBar + 1;	// 0 to a note every step
+const unsigned int kDynamicsBins = 40;
+const float kMaxAmplitude = 2.0;
+const unsigned int kBins = kPitchClassBins + kIntervalBins + kDensityBins + kDynamicsBins;
+
+// the controls that can be swept
+struct Control {
+	const char* name;
+	void (ProbabilisticArp::*set)(float);
+};
+
+const Control kControls[] = {
+	{"interval", &ProbabilisticArp::setIntervalTemp},
+	{"contour", &ProbabilisticArp::setContourTemp},
+	{"rhythmic", &ProbabilisticArp::setRhythmicTemp},
+	{"sparsity", &ProbabilisticArp::setSparsity},
+	{"consistency", &ProbabilisticArp::setConsistency},
+	{"movement", &ProbabilisticArp::setMovement},
+	{"harmonic", &ProbabilisticArp::setHarmonicTemp},
+	{"dynamic", &ProbabilisticArp::setDynamicTemp},
+	{"dynamicContour", &ProbabilisticArp::setDynamicContourTemp},
+	{"pitch", &ProbabilisticArp::setPitchTemp},
+	{"balance", &ProbabilisticArp::setSeedBalance}
+};
+const unsigned int kNumControls = sizeof(kControls) / sizeof(kControls[0]);
+
+struct Settings {
+	unsigned long long steps = 1000000;		// per grid point
+	unsigned int chains = 16;				// independent runs per grid point
+	unsigned int levels = 2;				// values of each swept control, spread over [0, 1]
+	std::vector<unsigned int> swept;		// indices into kControls
+	float fixed = 0.5;						// value of the controls not swept
+	std::vector<std::pair<int, int>> seeds;	// seed sequence pairs
+	std::shared_ptr<const SeedBank> bank = SeedBank::builtIn();
+	unsigned int tempDist = 0;
+	unsigned int mode = 0;
+	unsigned int threads = std::max(1u, std::thread::hardware_concurrency());		// which is 0 if it cannot tell
+	uint64_t baseSeed = 1;
+	bool binary = false;
+	std::string output;						// empty for standard output
+};
+
+struct GridPoint {
+	std::pair<int, int> seeds;
+	float controls[kNumControls];
+};
+
+// counts for one grid point, added to by every chain that runs it
+struct Histograms {
+	std::atomic<uint64_t> counts[kBins];
+	Histograms() {for (auto& count : counts) count = 0; }
+};
+
+static void usage()
+{
+	fprintf(stderr,
+			"usage: ArpMonteCarlo [options]\n"
+			"  --steps N        steps per grid point (default 1000000)\n"
+			"  --chains N       independent runs per grid point (default 16)\n"
+			"  --sweep LIST     comma separated controls to sweep, or all (default all)\n"
+			"  --levels N       values of each swept control, evenly over [0, 1] (default 2)\n"
+			"  --fixed X        value of every control not swept (default 0.5)\n"
+			"  --seeds LIST     seed pairs as a:b,c:d, or all different pairs (default all)\n"
+			"  --bank FILE      seed bank to take the seeds from (default: the built-in seeds)\n"
+			"  --temp-dist N    temperature distribution choice (default 0)\n"
+			"  --mode N         0 major, 1 minor (default 0)\n"
+			"  --threads N      worker threads (default: all cores, or 1 if unknown)\n"
+			"  --seed N         base random seed (default 1)\n"
+			"  --format F       csv or binary (default csv)\n"
+			"  --output FILE    (default: standard output)\n"
+			"controls:");
+	for (const Control& control : kControls) {
+		fprintf(stderr, " %s", control.name);
+	}
+	fprintf(stderr, "\n");
+}
+
+static std::vector<std::string> split(const char* list, char separator)
+{
+	std::vector<std::string> parts;
+	std::string part;
+	for (const char* c = list; ; c++) {
+		if (*c == separator || *c == 0) {
+			parts.push_back(part);
+			part.clear();
+			if (*c == 0) {
+				break;
+			}
+		}
+		else {
+			part += *c;
+		}
+	}
+	return parts;
+}
+
+static bool parse(int argc, char** argv, Settings& settings)
+{
+	const char* sweep = "all";
+	const char* seeds = "all";
+	for (int i = 1; i < argc; i++) {
+		const char* option = argv[i];
+		if (strcmp(option, "--help") == 0 || i + 1 >= argc) {
+			return false;
+		}
+		const char* value = argv[++i];
+		if (strcmp(option, "--steps") == 0) settings.steps = strtoull(value, nullptr, 10);
+		else if (strcmp(option, "--chains") == 0) settings.chains = atoi(value);
+		else if (strcmp(option, "--sweep") == 0) sweep = value;
+		else if (strcmp(option, "--levels") == 0) settings.levels = atoi(value);
+		else if (strcmp(option, "--fixed") == 0) settings.fixed = atof(value);
+		else if (strcmp(option, "--seeds") == 0) seeds = value;
+		else if (strcmp(option, "--bank") == 0) settings.bank = SeedBank::open(value);
+		else if (strcmp(option, "--temp-dist") == 0) settings.tempDist = atoi(value);
+		else if (strcmp(option, "--mode") == 0) settings.mode = atoi(value);
+		else if (strcmp(option, "--threads") == 0) settings.threads = atoi(value);
+		else if (strcmp(option, "--seed") == 0) settings.baseSeed = strtoull(value, nullptr, 10);
+		else if (strcmp(option, "--format") == 0) settings.binary = strcmp(value, "binary") == 0;
+		else if (strcmp(option, "--output") == 0) settings.output = value;
+		else {
+			fprintf(stderr, "unknown option %s\n", option);
+			return false;
+		}
+	}
+	if (settings.steps == 0 || settings.chains == 0 || settings.threads == 0) {
+		fprintf(stderr, "steps, chains and threads must be at least 1\n");
+		return false;
+	}
+	if (settings.levels < 2) {
+		fprintf(stderr, "levels must be at least 2\n");
+		return false;
+	}
+
+	for (const std::string& name : split(sweep, ',')) {
+		bool known = false;
+		for (unsigned int c = 0; c < kNumControls; c++) {
+			if (name == "all" || name == kControls[c].name) {
+				settings.swept.push_back(c);
+				known = true;
+			}
+		}
+		if (!known) {
+			fprintf(stderr, "unknown control %s\n", name.c_str());
+			return false;
+		}
+	}
+
+	if (!settings.bank) {
+		return false;
+	}
+	if (settings.bank->length() < kSubBeatsPerBeat * kBeatsPerBar * kBarsPerPattern) {
+		fprintf(stderr, "the seed bank's sequences are too short\n");
+		return false;
+	}
+	if (settings.bank->subBeatsPerBeat() != kSubBeatsPerBeat || settings.bank->beatsPerBar() != kBeatsPerBar) {
+		fprintf(stderr, "the seed bank was quantised to %u x %u, not %u x %u\n", 
+				settings.bank->subBeatsPerBeat(), settings.bank->beatsPerBar(), kSubBeatsPerBeat, kBeatsPerBar);
+		return false;
+	}
+	int numSeeds = settings.bank->size();
+	if (strcmp(seeds, "all") == 0) {
+		for (int a = 0; a < numSeeds; a++) {
+			for (int b = a + 1; b < numSeeds; b++) {
+				settings.seeds.push_back({a, b});
+			}
+		}
+	}
+	else {
+		for (const std::string& pair : split(seeds, ',')) {
+			int a, b;
+			if (sscanf(pair.c_str(), "%d:%d", &a, &b) != 2 || a < 0 || b < 0 || a >= numSeeds || b >= numSeeds) {
+				fprintf(stderr, "invalid seed pair %s\n", pair.c_str());
+				return false;
+			}
+			settings.seeds.push_back({a, b});
+		}
+	}
+	return true;
+}
+
+// every combination of the seed pairs and swept control levels
+static std::vector<GridPoint> makeGrid(const Settings& settings)
+{
+	unsigned int combinations = 1;
+	for (unsigned int s = 0; s < settings.swept.size(); s++) {
+		combinations *= settings.levels;
+	}
+
+	std::vector<GridPoint> grid;
+	for (const std::pair<int, int>& seeds : settings.seeds) {
+		for (unsigned int combination = 0; combination < combinations; combination++) {
+			GridPoint point;
+			point.seeds = seeds;
+			for (unsigned int c = 0; c < kNumControls; c++) {
+				point.controls[c] = settings.fixed;
+			}
+			// the first swept control changes fastest
+			unsigned int remainder = combination;
+			for (unsigned int control : settings.swept) {
+				point.controls[control] = (float)(remainder % settings.levels) / (settings.levels - 1);
+				remainder /= settings.levels;
+			}
+			grid.push_back(point);
+		}
+	}
+	return grid;
+}
+
+// one chain: count into a local histogram, then add it to the grid point's
+static void runChain(const Settings& settings, const GridPoint& point, uint64_t seed, unsigned long long steps, Histograms& histograms)
+{
+	ProbabilisticArp arp(kSubBeatsPerBeat, kBeatsPerBar, kBarsPerPattern, kLowestNote, kOctaves,
+						 point.seeds.first, point.seeds.second, 0, settings.tempDist, seed >> 1);
+	if (settings.bank != arp.getSeedBank()) {
+		arp.setSeedBank(settings.bank);
+		arp.setSeed(point.seeds.first, point.seeds.second);
+	}
+	arp.modeChange(settings.mode);
+	for (unsigned int c = 0; c < kNumControls; c++) {
+		(arp.*kControls[c].set)(point.controls[c]);
+	}
+	// start from the seed sequence as interpolated by the balance, as render.cpp does when the lead stops
+	arp.resetToSeed();
+	arp.play();
+
+	uint64_t counts[kBins] = {};
+	uint64_t* pitchClass = counts;
+	uint64_t* interval = pitchClass + kPitchClassBins;
+	uint64_t* density = interval + kIntervalBins;
+	uint64_t* dynamics = density + kDensityBins;
+
+	const unsigned int stepsPerBar = kSubBeatsPerBeat * kBeatsPerBar;
+	int previousNote = -1;
+	unsigned int notesInBar = 0;
+	for (unsigned long long step = 0; step < steps; step++) {
+		arp.beat();
+		std::pair<int, float> noteAmp = arp.generate();
+		int note = noteAmp.first;
+		if (note >= 0) {
+			pitchClass[note % 12]++;
+			if (previousNote >= 0) {
+				int semitones = std::max(-kMaxInterval, std::min(kMaxInterval, note - previousNote));
+				interval[semitones + kMaxInterval]++;
+			}
+			unsigned int bin = std::max(0.0f, noteAmp.second) / kMaxAmplitude * kDynamicsBins;
+			dynamics[std::min(bin, kDynamicsBins - 1)]++;
+			previousNote = note;
+			notesInBar++;
+		}
+		if (arp.getSequencePosition() % stepsPerBar == stepsPerBar - 1) {
+			density[notesInBar]++;
+			notesInBar = 0;
+		}
+	}
+
+	for (unsigned int bin = 0; bin < kBins; bin++) {
+		histograms.counts[bin].fetch_add(counts[bin], std::memory_order_relaxed);
+	}
+}
+
+static void writeCsv(FILE* file, const std::vector<GridPoint>& grid, const Histograms* histograms)
+{
+	fprintf(file, "seed1,seed2");
+	for (const Control& control : kControls) {
+		fprintf(file, ",%s", control.name);
+	}
+	for (unsigned int bin = 0; bin < kPitchClassBins; bin++) fprintf(file, ",pitchClass%u", bin);
+	for (int bin = -kMaxInterval; bin <= kMaxInterval; bin++) fprintf(file, ",interval%d", bin);
+	for (unsigned int bin = 0; bin < kDensityBins; bin++) fprintf(file, ",density%u", bin);
+	for (unsigned int bin = 0; bin < kDynamicsBins; bin++) fprintf(file, ",dynamics%g", bin * kMaxAmplitude / kDynamicsBins);
+	fprintf(file, "\n");
+
+	for (unsigned int p = 0; p < grid.size(); p++) {
+		fprintf(file, "%d,%d", grid[p].seeds.first, grid[p].seeds.second);
+		for (unsigned int c = 0; c < kNumControls; c++) {
+			fprintf(file, ",%g", grid[p].controls[c]);
+		}
+		for (unsigned int bin = 0; bin < kBins; bin++) {
+			fprintf(file, ",%llu", (unsigned long long)histograms[p].counts[bin].load());
+		}
+		fprintf(file, "\n");
+	}
+}
+
+static void writeBinary(FILE* file, const std::vector<GridPoint>& grid, const Histograms* histograms)
+{
+	const char magic[8] = "ARPMC1";
+	const uint32_t sizes[6] = {(uint32_t)grid.size(), kNumControls, kPitchClassBins, kIntervalBins, kDensityBins, kDynamicsBins};
+	fwrite(magic, 1, sizeof(magic), file);
+	fwrite(sizes, sizeof(uint32_t), 6, file);
+
+	for (unsigned int p = 0; p < grid.size(); p++) {
+		const int32_t seeds[2] = {grid[p].seeds.first, grid[p].seeds.second};
+		uint64_t counts[kBins];
+		for (unsigned int bin = 0; bin < kBins; bin++) {
+			counts[bin] = histograms[p].counts[bin].load();
+		}
+		fwrite(seeds, sizeof(int32_t), 2, file);
+		fwrite(grid[p].controls, sizeof(float), kNumControls, file);
+		fwrite(counts, sizeof(uint64_t), kBins, file);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!parse(argc, argv, settings)) {
+		usage();
+		return 1;
+	}
+
+	std::vector<GridPoint> grid = makeGrid(settings);
+	std::unique_ptr<Histograms[]> histograms(new Histograms[grid.size()]);
+	const unsigned long long chainSteps = (settings.steps + settings.chains - 1) / settings.chains;
+	const unsigned long long chains = (unsigned long long)grid.size() * settings.chains;
+	fprintf(stderr, "%zu grid points x %llu steps = %.3g steps on %u threads\n",
+			grid.size(), chainSteps * settings.chains, (double)chains * chainSteps, settings.threads);
+
+	// the threads take chains in order until there are none left
+	std::atomic<unsigned long long> nextChain(0);
+	auto work = [&]() {
+		for (unsigned long long chain = nextChain++; chain < chains; chain = nextChain++) {
+			unsigned long long point = chain / settings.chains;
+			uint64_t seed = rng::splitMix64(settings.baseSeed ^ rng::splitMix64(chain));
+			runChain(settings, grid[point], seed, chainSteps, histograms[point]);
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < settings.threads; t++) {
+		threads.emplace_back(work);
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	fprintf(stderr, "%.2f s, %.3g steps per second\n", elapsed.count(), chains * chainSteps / elapsed.count());
+
+	FILE* file = settings.output.empty() ? stdout : fopen(settings.output.c_str(), settings.binary ? "wb" : "w");
+	if (file == nullptr) {
+		fprintf(stderr, "unable to open %s\n", settings.output.c_str());
+		return 1;
+	}
+	if (settings.binary) {
+		writeBinary(file, grid, histograms.get());
+	}
+	else {
+		writeCsv(file, grid, histograms.get());
+	}
+	if (file != stdout) {
+		fclose(file);
+	}
+	return 0;
+}
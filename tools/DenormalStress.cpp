@@ -0,0 +1,98 @@
+/***** DenormalStress.cpp *****/
+
+/*
+Renders notes followed by long silences through the filter chain (control-rate
+envelope ramps into a bank of ladder filters, oversampled as the lead is) and prints
+the time per audio block over each stretch. With the denormal protection the
+silences should cost the same as the notes.
+Host tool, not part of the Bela project. Build from this directory with:
+	g++ -std=c++14 -O2 -I.. DenormalStress.cpp ../MoogFilterBank.cpp -o DenormalStress
+Run with --no-ftz to leave flush-to-zero off and rely on the state flushing alone.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "ControlRate.h"
+#include "Denormals.h"
+#include "MoogFilterBank.h"
+
+const float kSampleRate = 44100;
+const unsigned int kBlockSize = 16;
+const unsigned int kOversampling = 2;
+
+// one note, then silence: an exponential envelope like an ADSR release
+struct Stretch {
+	const char* name;
+	float seconds;
+	bool noteOn;
+};
+
+int main(int argc, char** argv)
+{
+	bool ftz = !(argc > 1 && strcmp(argv[1], "--no-ftz") == 0);
+	printf("flush to zero: %s, %u sample blocks, %ux oversampled ladder\n", ftz ? "on" : "off", kBlockSize, kOversampling);
+
+	MoogFilterBank filters(kSampleRate, MoogFilter::kLowpass12);
+	filters.set_oversampling(kOversampling);
+	for (unsigned int lane = 0; lane < MoogFilterBank::kLanes; lane++) {
+		filters.set_params(lane, 800 + 400 * lane, 0.9);
+	}
+	ControlRamp amplitude;
+
+	std::vector<std::vector<float>> buffers(MoogFilterBank::kLanes, std::vector<float>(kBlockSize));
+	float* lanes[MoogFilterBank::kLanes];
+	for (unsigned int lane = 0; lane < MoogFilterBank::kLanes; lane++) {
+		lanes[lane] = buffers[lane].data();
+	}
+
+	const Stretch stretches[] = {{"note", 0.5, true}, {"release", 2, false}, {"silence", 10, false},
+								 {"note", 0.5, true}, {"release", 2, false}, {"silence", 30, false}};
+
+	float envelope = 0;
+	unsigned int controlPhase = 0;
+	uint32_t noise = 1;
+
+	// noise through the envelope and filters
+	auto renderBlock = [&](bool noteOn) {
+		for (unsigned int n = 0; n < kBlockSize; n++) {
+			// the envelope decays towards 0 without ever reaching it
+			if (controlPhase == 0) {
+				envelope = noteOn ? 1.0f : envelope * 0.99f;
+				amplitude.setTarget(envelope);
+				controlPhase = kControlPeriod;
+			}
+			controlPhase--;
+			float amp = amplitude.process();
+			for (unsigned int lane = 0; lane < MoogFilterBank::kLanes; lane++) {
+				noise = noise * 1664525u + 1013904223u;
+				lanes[lane][n] = amp * ((float)(noise >> 8) / (1 << 24) - 0.5f);
+			}
+		}
+		filters.process_block(lanes, lanes, kBlockSize);
+	};
+
+	for (const Stretch& stretch : stretches) {
+		unsigned int blocks = stretch.seconds * kSampleRate / kBlockSize;
+		double nanoseconds = 0;
+		double worst = 0;
+		for (unsigned int b = 0; b < blocks; b++) {
+			auto start = std::chrono::steady_clock::now();
+			if (ftz) {
+				ScopedFlushDenormals noDenormals;
+				renderBlock(stretch.noteOn);
+			}
+			else {
+				renderBlock(stretch.noteOn);
+			}
+			std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			nanoseconds += elapsed.count();
+			worst = std::max(worst, elapsed.count());
+		}
+		printf("%-8s %5.1f s   mean %7.0f ns/block   worst %7.0f ns/block\n", stretch.name, stretch.seconds, nanoseconds / blocks, worst);
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+/***** FastMathBench.cpp *****/
+
+/*
+Error bounds and speed of the FastMath.h approximations, against the standard library.
+Host tool, not part of the Bela project. Build from this directory with one of:
+	g++ -std=c++14 -O2 -I.. FastMathBench.cpp -o FastMathBench						(SSE2 on x86)
+	g++ -std=c++14 -O2 -DSIMD_SCALAR -I.. FastMathBench.cpp -o FastMathBench		(scalar)
+	g++ -std=c++14 -O2 -mfpu=neon -mfloat-abi=hard -I.. FastMathBench.cpp -o FastMathBench	(NEON, on Bela)
+*/
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "FastMath.h"
+
+// number of inputs for each test, and passes over them when timing
+const unsigned int kPoints = 1 << 16;
+const unsigned int kPasses = 64;
+
+struct Result {
+	double maxAbsolute = 0;		// largest absolute error
+	double maxRelative = 0;		// largest error relative to the reference
+};
+
+// evenly spaced inputs over [low, high]
+static std::vector<float> inputs(float low, float high)
+{
+	std::vector<float> x(kPoints);
+	for (unsigned int n = 0; n < kPoints; n++) {
+		x[n] = low + (high - low) * n / (kPoints - 1);
+	}
+	return x;
+}
+
+static void accumulate(Result& result, double value, double reference)
+{
+	double error = std::fabs(value - reference);
+	result.maxAbsolute = std::max(result.maxAbsolute, error);
+	if (reference != 0) {
+		result.maxRelative = std::max(result.maxRelative, error / std::fabs(reference));
+	}
+}
+
+// nanoseconds per value of f applied to every input, one float at a time
+template <typename Function>
+static double timeScalar(const std::vector<float>& x, Function f)
+{
+	volatile float sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int pass = 0; pass < kPasses; pass++) {
+		float sum = 0;
+		for (unsigned int n = 0; n < kPoints; n++) {
+			sum += f(x[n]);
+		}
+		sink = sink + sum;
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / ((double)kPasses * kPoints);
+}
+
+// nanoseconds per value of f applied to every input, four at a time
+template <typename Function>
+static double timeVector(const std::vector<float>& x, Function f)
+{
+	volatile float sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int pass = 0; pass < kPasses; pass++) {
+		simd::float4 sum = simd::float4::set1(0);
+		for (unsigned int n = 0; n < kPoints; n += simd::kLanes) {
+			sum = sum + f(simd::float4::load(&x[n]));
+		}
+		sink = sink + simd::sum(sum);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / ((double)kPasses * kPoints);
+}
+
+// compare both versions of an approximation with the (double precision) reference,
+// and time them against the standard library float function
+template <typename Scalar, typename Vector, typename Standard, typename Reference>
+static void bench(const char* name, float low, float high, Scalar scalar, Vector vector, Standard standard, Reference reference)
+{
+	std::vector<float> x = inputs(low, high);
+
+	Result scalarResult, vectorResult;
+	float lanes[simd::kLanes];
+	for (unsigned int n = 0; n < kPoints; n += simd::kLanes) {
+		vector(simd::float4::load(&x[n])).store(lanes);
+		for (unsigned int i = 0; i < simd::kLanes; i++) {
+			double exact = reference((double)x[n + i]);
+			accumulate(scalarResult, scalar(x[n + i]), exact);
+			accumulate(vectorResult, lanes[i], exact);
+		}
+	}
+
+	printf("%-6s [%g, %g]\n", name, low, high);
+	printf("    scalar     max abs %.3g  max rel %.3g  %6.2f ns\n", scalarResult.maxAbsolute, scalarResult.maxRelative, timeScalar(x, scalar));
+	printf("    float4     max abs %.3g  max rel %.3g  %6.2f ns\n", vectorResult.maxAbsolute, vectorResult.maxRelative, timeVector(x, vector));
+	printf("    std                                      %6.2f ns\n", timeScalar(x, standard));
+}
+
+int main()
+{
+#if SIMD_NEON
+	printf("backend: NEON\n");
+#elif SIMD_SSE
+	printf("backend: SSE2\n");
+#else
+	printf("backend: scalar\n");
+#endif
+
+	bench("tanh", -8, 8,
+		  [](float x) {return fastmath::tanh(x); },
+		  [](simd::float4 x) {return fastmath::tanh(x); },
+		  [](float x) {return tanhf(x); },
+		  [](double x) {return std::tanh(x); });
+	bench("exp2", -20, 20,
+		  [](float x) {return fastmath::exp2(x); },
+		  [](simd::float4 x) {return fastmath::exp2(x); },
+		  [](float x) {return exp2f(x); },
+		  [](double x) {return std::exp2(x); });
+	bench("log2", 1e-3, 1e3,
+		  [](float x) {return fastmath::log2(x); },
+		  [](simd::float4 x) {return fastmath::log2(x); },
+		  [](float x) {return log2f(x); },
+		  [](double x) {return std::log2(x); });
+	// powf(10, dB / 20), as used for amplitude conversions
+	bench("pow", -60, 12,
+		  [](float x) {return fastmath::pow(10.0f, x / 20.0f); },
+		  [](simd::float4 x) {return fastmath::pow(simd::float4::set1(10.0f), x * simd::float4::set1(1 / 20.0f)); },
+		  [](float x) {return powf(10.0f, x / 20.0f); },
+		  [](double x) {return std::pow(10.0, x / 20.0); });
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+/***** MoogParamsBench.cpp *****/
+
+/*
+Cost of MoogFilter::set_params, which render() calls every sample for each filter,
+against the original version (seven powf() calls and a divide by the sample rate on
+every call), and of the two ways of mapping cutoff to coefficients without powf():
+a log-spaced lookup table with linear interpolation, and the polynomials in Horner
+form that set_params uses. The table's largest error against the polynomials is
+printed too.
+Host tool, not part of the Bela project. Build from this directory with:
+	g++ -std=c++14 -O2 -I.. MoogParamsBench.cpp ../MoogFilter.cpp -o MoogParamsBench
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "MoogFilter.h"
+
+const float kSampleRate = 44100;
+const unsigned int kCalls = 10000000;
+const float kLowestCutoff = 20;
+const float kHighestCutoff = 20000;
+
+// coefficients for one cutoff and resonance
+struct Coefficients {
+	float g;
+	float res;
+};
+
+// the original set_params, including its section coefficients
+static Coefficients originalParams(float frequencyHz, float resonance, float sampleRate, float& a1, float& b0, float& b1)
+{
+	float omega = 2 * M_PI * frequencyHz  / sampleRate;
+	float g = 0.9892 * omega - 0.4342 * powf(omega, 2) + 0.1381 * powf(omega, 3) - 0.0202 * powf(omega, 4);
+	float res = resonance * (1.0029 + 0.0526 * omega - 0.0926 * powf(omega, 2) + 0.0218 * powf(omega, 3));
+	a1 = g - 1;
+	b0 = g / 1.3;
+	b1 = 0.3 * g / 1.3;
+	return {g, res};
+}
+
+// the mapping set_params uses now
+static Coefficients polynomialParams(float frequencyHz, float resonance, float omegaScale)
+{
+	float omega = frequencyHz * omegaScale;
+	float g = omega * (0.9892f + omega * (-0.4342f + omega * (0.1381f - 0.0202f * omega)));
+	float res = resonance * (1.0029f + omega * (0.0526f + omega * (-0.0926f + 0.0218f * omega)));
+	return {g, res};
+}
+
+// g and the resonance scaling at kPerOctave points per octave from kLowestCutoff, looked up
+// by a log2 taken from the float's exponent and a quadratic fit to the mantissa
+class ParamsTable {
+public:
+	static const unsigned int kPerOctave = 16;
+
+	ParamsTable(float sampleRate)
+	{
+		unsigned int octaves = ceilf(log2f(kHighestCutoff / kLowestCutoff));
+		unsigned int size = octaves * kPerOctave + 2;
+		g_.resize(size);
+		resScale_.resize(size);
+		float omegaScale = 2 * M_PI / sampleRate;
+		for (unsigned int n = 0; n < size; n++) {
+			Coefficients c = polynomialParams(kLowestCutoff * exp2f((float)n / kPerOctave), 1, omegaScale);
+			g_[n] = c.g;
+			resScale_[n] = c.res;
+		}
+		logLowest_ = log2f(kLowestCutoff);
+	}
+
+	Coefficients lookup(float frequencyHz, float resonance) const
+	{
+		float position = (fastLog2(frequencyHz) - logLowest_) * kPerOctave;
+		position = std::min(std::max(position, 0.0f), (float)(g_.size() - 2));
+		unsigned int index = position;
+		float fraction = position - index;
+		float g = g_[index] + fraction * (g_[index + 1] - g_[index]);
+		float res = resScale_[index] + fraction * (resScale_[index + 1] - resScale_[index]);
+		return {g, resonance * res};
+	}
+
+private:
+	static float fastLog2(float x)
+	{
+		uint32_t bits;
+		memcpy(&bits, &x, sizeof(bits));
+		float exponent = (float)((int)(bits >> 23) - 127);
+		bits = (bits & 0x007fffff) | 0x3f800000;		// mantissa in [1, 2)
+		float m;
+		memcpy(&m, &bits, sizeof(m));
+		return exponent + (-0.34484843f * m + 2.02466578f) * m - 1.67487759f;
+	}
+
+	std::vector<float> g_;
+	std::vector<float> resScale_;
+	float logLowest_;
+};
+
+// cutoffs swept exponentially over the audio range, as an envelope moves them
+static std::vector<float> cutoffs()
+{
+	std::vector<float> f(4096);
+	for (unsigned int n = 0; n < f.size(); n++) {
+		f[n] = kLowestCutoff * powf(kHighestCutoff / kLowestCutoff, (float)n / (f.size() - 1));
+	}
+	return f;
+}
+
+// nanoseconds per call of f(n)
+template <typename Function>
+static double time(Function f)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int n = 0; n < kCalls; n++) {
+		f(n);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / kCalls;
+}
+
+int main()
+{
+	const std::vector<float> f = cutoffs();
+	const unsigned int mask = f.size() - 1;
+	const float omegaScale = 2 * M_PI / kSampleRate;
+	volatile float sink = 0;
+
+	// the mappings alone
+	ParamsTable table(kSampleRate);
+	double worstG = 0, worstRes = 0;
+	for (float frequency : f) {
+		Coefficients exact = polynomialParams(frequency, 1, omegaScale);
+		Coefficients looked = table.lookup(frequency, 1);
+		worstG = std::max(worstG, (double)fabsf(looked.g - exact.g) / exact.g);
+		worstRes = std::max(worstRes, (double)fabsf(looked.res - exact.res) / exact.res);
+	}
+	double tableTime = time([&](unsigned int n) {Coefficients c = table.lookup(f[n & mask], 0.5f); sink = c.g + c.res; });
+	double polynomialTime = time([&](unsigned int n) {Coefficients c = polynomialParams(f[n & mask], 0.5f, omegaScale); sink = c.g + c.res; });
+	printf("cutoff mapping         table %.1f ns (largest relative error g %.2g, res %.2g), polynomial %.1f ns\n",
+		   tableTime, worstG, worstRes, polynomialTime);
+
+	// set_params, before and after
+	float a1, b0, b1;
+	double originalMoving = time([&](unsigned int n) {originalParams(f[n & mask], 0.5f, kSampleRate, a1, b0, b1); sink = a1 + b0 + b1; });
+	double originalHeld = time([&](unsigned int) {originalParams(f[0], 0.5f, kSampleRate, a1, b0, b1); sink = a1 + b0 + b1; });
+	MoogFilter filter(kSampleRate, MoogFilter::kLowpass12);
+	double moving = time([&](unsigned int n) {filter.set_params(f[n & mask], 0.5f); });
+	double held = time([&](unsigned int) {filter.set_params(f[0], 0.5f); });
+	double withProcess = time([&](unsigned int n) {filter.set_params(f[(n >> 4) & mask], 0.5f); sink = filter.process(sink * 0.5f + 0.1f); });
+	printf("moving cutoff          original %.1f ns, set_params %.1f ns\n", originalMoving, moving);
+	printf("held cutoff            original %.1f ns, set_params %.1f ns\n", originalHeld, held);
+	printf("set_params + process   %.1f ns (cutoff changing every 16 samples)\n", withProcess);
+	return 0;
+}
@@ -0,0 +1,370 @@
+/***** SeedImporter.cpp *****/
+
+/*
+Build a seed bank for the arpeggiator (see SeedBank.h) from Standard MIDI Files.
+Every note on of each file is quantised to the nearest sub-beat of the grid (a beat
+is a quarter note), and where several land on the same sub-beat the loudest is kept
+(the highest of equally loud ones), so each file becomes a single line of steps. The
+line is cut into patterns of subBeatsPerBeat x beatsPerBar x barsPerPattern steps,
+starting every --hop bars from the start of the file, and every pattern with enough
+notes becomes a seed sequence. Amplitudes are velocities in hundredths, so velocity
+100 is the amplitude 1.0 of the built-in seeds, and steps without a note have the
+built-in seeds' amplitude for them (SeedBank::kRestAmplitude).
+
+Host tool, not part of the Bela project. Build from this directory with:
+	g++ -std=c++14 -O2 -Drt_printf=printf -I.. SeedImporter.cpp ../SeedBank.cpp -o SeedImporter
+For example, the arpeggiator's 4 x 4 x 4 grid from two files:
+	./SeedImporter --output ../seeds.bank corpus/one.mid corpus/two.mid
+(render.cpp loads seeds.bank from the project folder if there is one.)
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+#include "SeedBank.h"
+
+struct Settings {
+	unsigned int subBeatsPerBeat = 4;		// the grid
+	unsigned int beatsPerBar = 4;
+	unsigned int barsPerPattern = 4;
+	unsigned int hop = 0;					// bars from one pattern to the next (0 for barsPerPattern)
+	int channel = 0;						// 1 to 16, or 0 for all
+	unsigned int minNotes = 4;				// fewest notes in a pattern kept
+	bool unique = true;						// leave out patterns already in the bank
+	std::string output;
+	std::vector<std::string> inputs;
+};
+
+// a note on, at its time in ticks
+struct NoteOn {
+	unsigned long long tick;
+	int channel;
+	int note;
+	int velocity;
+};
+
+static void usage()
+{
+	fprintf(stderr,
+			"usage: SeedImporter [options] --output FILE input.mid...\n"
+			"  --metre S:B:P    sub-beats per beat, beats per bar, bars per pattern (default 4:4:4)\n"
+			"  --hop N          bars from one pattern to the next (default: bars per pattern)\n"
+			"  --channel N      only notes on MIDI channel N, 1 to 16 (default: all)\n"
+			"  --min-notes N    fewest notes in a pattern kept (default 4)\n"
+			"  --unique N       1 to leave out repeated patterns, 0 to keep them (default 1)\n"
+			"  --output FILE    the seed bank to write\n");
+}
+
+static bool parse(int argc, char** argv, Settings& settings)
+{
+	for (int i = 1; i < argc; i++) {
+		const char* option = argv[i];
+		if (strncmp(option, "--", 2) != 0) {
+			settings.inputs.push_back(option);
+			continue;
+		}
+		if (strcmp(option, "--help") == 0 || i + 1 >= argc) {
+			return false;
+		}
+		const char* value = argv[++i];
+		if (strcmp(option, "--metre") == 0) {
+			if (sscanf(value, "%u:%u:%u", &settings.subBeatsPerBeat, &settings.beatsPerBar, &settings.barsPerPattern) != 3) {
+				return false;
+			}
+		}
+		else if (strcmp(option, "--hop") == 0) settings.hop = atoi(value);
+		else if (strcmp(option, "--channel") == 0) settings.channel = atoi(value);
+		else if (strcmp(option, "--min-notes") == 0) settings.minNotes = atoi(value);
+		else if (strcmp(option, "--unique") == 0) settings.unique = atoi(value) != 0;
+		else if (strcmp(option, "--output") == 0) settings.output = value;
+		else {
+			fprintf(stderr, "unknown option %s\n", option);
+			return false;
+		}
+	}
+	if (settings.hop == 0) {
+		settings.hop = settings.barsPerPattern;
+	}
+	return settings.subBeatsPerBeat > 0 && settings.beatsPerBar > 0 && settings.barsPerPattern > 0 &&
+		   settings.channel >= 0 && settings.channel <= 16 && !settings.output.empty() && !settings.inputs.empty();
+}
+
+// big-endian reads from a byte buffer, which fail (return false) at the end
+class Reader {
+public:
+	Reader(const unsigned char* data, size_t size) : data_(data), size_(size), position_(0) {}
+
+	bool byte(unsigned int& value)
+	{
+		if (position_ >= size_) {
+			return false;
+		}
+		value = data_[position_++];
+		return true;
+	}
+
+	bool fixed(unsigned int bytes, unsigned long& value)
+	{
+		value = 0;
+		for (unsigned int b = 0; b < bytes; b++) {
+			unsigned int next;
+			if (!byte(next)) {
+				return false;
+			}
+			value = (value << 8) | next;
+		}
+		return true;
+	}
+
+	// variable length quantity: 7 bits a byte, the top bit set on all but the last
+	bool variable(unsigned long& value)
+	{
+		value = 0;
+		for (unsigned int b = 0; b < 4; b++) {
+			unsigned int next;
+			if (!byte(next)) {
+				return false;
+			}
+			value = (value << 7) | (next & 0x7f);
+			if ((next & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool skip(unsigned long bytes)
+	{
+		if (bytes > size_ - position_) {
+			return false;
+		}
+		position_ += bytes;
+		return true;
+	}
+
+	size_t position() const {return position_; }
+	bool atEnd() const {return position_ >= size_; }
+
+private:
+	const unsigned char* data_;
+	size_t size_;
+	size_t position_;
+};
+
+// the note ons of one track
+static bool readTrack(Reader reader, std::vector<NoteOn>& notes)
+{
+	unsigned long long tick = 0;
+	unsigned int status = 0;			// running status
+	while (!reader.atEnd()) {
+		unsigned long delta;
+		unsigned int first;
+		if (!reader.variable(delta) || !reader.byte(first)) {
+			return false;
+		}
+		tick += delta;
+
+		if (first == 0xff) {
+			// meta event: type, length, data
+			unsigned int type;
+			unsigned long length;
+			if (!reader.byte(type) || !reader.variable(length) || !reader.skip(length)) {
+				return false;
+			}
+			status = 0;
+			if (type == 0x2f) {			// end of track
+				return true;
+			}
+			continue;
+		}
+		if (first == 0xf0 || first == 0xf7) {
+			// system exclusive: length, data
+			unsigned long length;
+			if (!reader.variable(length) || !reader.skip(length)) {
+				return false;
+			}
+			status = 0;
+			continue;
+		}
+
+		unsigned int data1;
+		if (first & 0x80) {
+			status = first;
+			if (!reader.byte(data1)) {
+				return false;
+			}
+		}
+		else if (status != 0) {
+			data1 = first;				// running status: the first byte was data
+		}
+		else {
+			return false;
+		}
+
+		unsigned int type = status & 0xf0;
+		unsigned int data2 = 0;
+		if (type != 0xc0 && type != 0xd0 && !reader.byte(data2)) {		// program change and channel pressure have one data byte
+			return false;
+		}
+		if (type == 0x90 && data2 > 0) {
+			notes.push_back({tick, (int)(status & 0x0f) + 1, (int)data1, (int)data2});
+		}
+	}
+	return true;
+}
+
+// the note ons of every track, and the ticks per quarter note
+static bool readFile(const std::string& path, std::vector<NoteOn>& notes, unsigned int& ticksPerBeat)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		fprintf(stderr, "unable to open %s\n", path.c_str());
+		return false;
+	}
+	std::vector<unsigned char> data;
+	unsigned char buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + count);
+	}
+	fclose(file);
+
+	Reader reader(data.data(), data.size());
+	bool header = false;
+	while (!reader.atEnd()) {
+		unsigned long id, length;
+		if (!reader.fixed(4, id) || !reader.fixed(4, length) || length > data.size() - reader.position()) {
+			fprintf(stderr, "%s: truncated chunk\n", path.c_str());
+			return false;
+		}
+		if (id == 0x4d546864) {			// "MThd"
+			unsigned long format, tracks, division;
+			Reader chunk(data.data() + reader.position(), length);
+			if (!chunk.fixed(2, format) || !chunk.fixed(2, tracks) || !chunk.fixed(2, division)) {
+				fprintf(stderr, "%s: invalid header\n", path.c_str());
+				return false;
+			}
+			if ((division & 0x8000) || division == 0) {
+				fprintf(stderr, "%s: SMPTE time is not supported\n", path.c_str());
+				return false;
+			}
+			ticksPerBeat = division;
+			header = true;
+		}
+		else if (id == 0x4d54726b) {		// "MTrk"
+			if (!header) {
+				fprintf(stderr, "%s: track before the header\n", path.c_str());
+				return false;
+			}
+			if (!readTrack(Reader(data.data() + reader.position(), length), notes)) {
+				fprintf(stderr, "%s: invalid track\n", path.c_str());
+				return false;
+			}
+		}
+		reader.skip(length);				// other chunks are ignored
+	}
+	if (!header) {
+		fprintf(stderr, "%s: not a MIDI file\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+// quantise the notes to a single line of steps, and cut it into patterns
+static void makePatterns(const Settings& settings, const std::vector<NoteOn>& notes, unsigned int ticksPerBeat,
+						 std::vector<SeedBank::Step>& patterns, std::set<std::string>& seen, unsigned int& count)
+{
+	const unsigned int stepsPerBar = settings.subBeatsPerBeat * settings.beatsPerBar;
+	const unsigned int length = stepsPerBar * settings.barsPerPattern;
+	const double ticksPerStep = (double)ticksPerBeat / settings.subBeatsPerBeat;
+
+	const SeedBank::Step rest {-1, SeedBank::kRestAmplitude};
+
+	std::vector<SeedBank::Step> line;
+	for (const NoteOn& note : notes) {
+		if (settings.channel != 0 && note.channel != settings.channel) {
+			continue;
+		}
+		size_t step = llround(note.tick / ticksPerStep);
+		if (step >= line.size()) {
+			line.resize(step + 1, rest);
+		}
+		SeedBank::Step& current = line[step];
+		if (current.note < 0 || note.velocity > current.amplitude || (note.velocity == current.amplitude && note.note > current.note)) {
+			current = {(int8_t)note.note, (uint8_t)note.velocity};
+		}
+	}
+
+	for (size_t start = 0; start < line.size(); start += settings.hop * stepsPerBar) {
+		std::vector<SeedBank::Step> pattern(length, rest);
+		unsigned int notesInPattern = 0;
+		for (unsigned int i = 0; i < length && start + i < line.size(); i++) {
+			pattern[i] = line[start + i];
+			if (pattern[i].note >= 0) {
+				notesInPattern++;
+			}
+		}
+		if (notesInPattern < settings.minNotes) {
+			continue;
+		}
+		if (settings.unique && !seen.insert(std::string((const char*)pattern.data(), length * sizeof(SeedBank::Step))).second) {
+			continue;
+		}
+		patterns.insert(patterns.end(), pattern.begin(), pattern.end());
+		count++;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!parse(argc, argv, settings)) {
+		usage();
+		return 1;
+	}
+
+	std::vector<SeedBank::Step> patterns;
+	std::set<std::string> seen;
+	unsigned int numSeeds = 0;
+	unsigned int failed = 0;
+	for (const std::string& input : settings.inputs) {
+		std::vector<NoteOn> notes;
+		unsigned int ticksPerBeat;
+		if (!readFile(input, notes, ticksPerBeat)) {
+			failed++;
+			continue;
+		}
+		unsigned int before = numSeeds;
+		makePatterns(settings, notes, ticksPerBeat, patterns, seen, numSeeds);
+		fprintf(stderr, "%s: %zu notes, %u seeds\n", input.c_str(), notes.size(), numSeeds - before);
+	}
+	if (numSeeds == 0) {
+		fprintf(stderr, "no seeds found\n");
+		return 1;
+	}
+
+	SeedBank::FileHeader header;
+	memcpy(header.magic, SeedBank::kMagic, sizeof(header.magic));
+	header.headerSize = sizeof(header);
+	header.size = numSeeds;
+	header.length = settings.subBeatsPerBeat * settings.beatsPerBar * settings.barsPerPattern;
+	header.subBeatsPerBeat = settings.subBeatsPerBeat;
+	header.beatsPerBar = settings.beatsPerBar;
+	header.barsPerPattern = settings.barsPerPattern;
+
+	FILE* file = fopen(settings.output.c_str(), "wb");
+	if (file == nullptr) {
+		fprintf(stderr, "unable to open %s\n", settings.output.c_str());
+		return 1;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(patterns.data(), sizeof(SeedBank::Step), patterns.size(), file);
+	fclose(file);
+	fprintf(stderr, "%u seeds of %u steps from %zu files (%u unreadable) in %s\n",
+			numSeeds, header.length, settings.inputs.size() - failed, failed, settings.output.c_str());
+	return 0;
+}